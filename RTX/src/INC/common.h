@@ -76,8 +76,8 @@
 
 #define TID_NULL            0       /* pre-defined Task ID for null task */
 #define TID_KCD             159     /* pre-defined Task ID for KCD task */
-#define TID_UART_IRQ        0xFF    /* reserved TID for UART IRQ handler which is not a task */
-#define MAX_TASKS           160     /* maximum number of tasks in the system */
+#define TID_UART_IRQ        0xFFFF  /* reserved TID for UART IRQ handler which is not a task */
+#define MAX_TASKS           4096    /* maximum number of tasks in the system, at most TID_UART_IRQ */
 #define K_STACK_SIZE        0x200   /* task kernel stack size in bytes */
 #define U_STACK_SIZE        0x200   /* task user space stack size in bytes */
 
@@ -133,7 +133,7 @@ typedef unsigned char       BIT;
 typedef unsigned int        BOOL;
 typedef unsigned int        size_t;
 typedef signed int          ssize_t;
-typedef unsigned char       task_t;
+typedef unsigned short      task_t;
 
 
 /*
@@ -165,6 +165,7 @@ typedef struct rtx_sys_info {
     U32                 rtx_time_qtm;       /**< time granularity in microseconds  */
     POLLING_SERVER      server;             /**< scheduling server for non-real-time tasks */
     U8                  sched;              /**< scheduler                         */
+    U32                 mem_split;          /**< first address of the stack region, the heap ends here */
 } RTX_SYS_INFO;
 
 /**
@@ -184,12 +185,15 @@ typedef struct rtx_task_info {
     U32                 u_stack_hi;         /**> user stack base addr. (high addr.) */
     U16                 k_stack_size;       /**> kernel stack size in bytes         */
     U16                 u_stack_size;       /**> user stack size in bytes           */
+    U16                 k_stack_used;       /**> deepest kernel stack use in bytes  */
+    U16                 u_stack_used;       /**> deepest user stack use in bytes    */
     task_t              tid;                /**> task ID                            */
     U8                  prio;               /**> execution priority                 */
     U8                  state;              /**> task state                         */
     U8                  priv;               /**> = 0 unprivileged, =1 privileged    */
     /* The following only applies to real-time tasks */
     TIMEVAL             p_n;                /**> period in seconds and microseconds */
+    TIMEVAL             c_n;                /**> worst-case execution time of a job */
     size_t              rt_mbx_size;        /**> real-time task mailbox capacity    */
 } RTX_TASK_INFO;
 
@@ -198,6 +202,7 @@ typedef struct rtx_task_info {
  */
 typedef struct task_rt {
     TIMEVAL             p_n;                /**> period in seconds and microseconds */
+    TIMEVAL             c_n;                /**> worst-case execution time of a job */
     void                (*task_entry)();    /**> task entry address                 */
     U16                 u_stack_size;       /**> user stack size in bytes           */
     size_t              rt_mbx_size;        /**> mailbox size in bytes              */
@@ -46,12 +46,40 @@
  *
  *****************************************************************************/
 
+#ifndef COMMON_EXT_H_
+#define COMMON_EXT_H_
+
 /*
  *===========================================================================
  *                             MACROS
  *===========================================================================
  */
 
+/* Memory Algorithms, continues the list in common.h */
+#define TLSF                4       /* two-level segregated fit, O(1) alloc and dealloc */
+#define SEG_FIT             5       /* size class lists for small blocks in front of first fit */
+
+/* Fixed Size Block Pools */
+#define MAX_POOLS           16      /* maximum number of pools alive at the same time */
+
+/* Memory Statistics */
+#define MEM_STATS_BUCKETS   16      /* log2 latency buckets, the last one also takes everything slower */
+
+/* Deadline Misses, what happens to a real-time job that is still running at its deadline */
+#define MISS_CONTINUE       0       /* it runs on, the releases it overran follow it right away */
+#define MISS_SKIP           1       /* it runs on, the releases it overran are dropped */
+#define MISS_ABORT          2       /* it is dropped with its heap blocks, the task starts over at its entry for the next job */
+#define MISS_DEMOTE         3       /* it finishes at LOWEST priority (PRIO_BG under RM_PS), the next job is real-time again */
+#define MISS_NOTIFY         0x80    /* or'ed with one of the above, every miss is reported to a supervisor */
+#define RT_MISS             10      /* message type of those reports, an RT_MISS_INFO follows the header */
+
+/* Under RM_PS the tasks that are not real-time only run on the polling server budget, which admission
+ * control has set aside for them. A demoted job does not take it, it finishes at PRIO_BG instead:
+ * it runs only when no real-time task is ready and the server is out of budget or has no work,
+ * in place of the null task, and its ticks are not charged to the server.
+ * Only the kernel puts a task there, tsk_create and tsk_set_prio reject it like PRIO_NULL. */
+#define PRIO_BG             254     /* priority of a demoted job under RM_PS, below LOWEST */
+
 /*
  *===========================================================================
  *                             TYPEDEFS
@@ -65,6 +93,43 @@
  *===========================================================================
  */
  
+/**
+ * @brief   heap statistics, filled by mem_get_stats()
+ * @note    bucket i of a histogram counts calls that took [2^(i-1), 2^i) us, bucket 0 those under 1 us
+ */
+typedef struct rtx_mem_stats {
+    U32 alloc_count;        /**> successful allocations                      */
+    U32 alloc_fail_count;   /**> allocations that returned NULL              */
+    U32 dealloc_count;      /**> blocks freed, including reclaim on exit     */
+    U32 bytes_in_use;       /**> payload bytes currently allocated           */
+    U32 bytes_hwm;          /**> highest bytes_in_use seen                   */
+    U32 largest_free;       /**> payload bytes of the largest free block     */
+    U32 free_blocks;        /**> number of free blocks                       */
+    U32 free_bytes;         /**> payload bytes in all free blocks            */
+    U32 alloc_hist[MEM_STATS_BUCKETS];
+    U32 dealloc_hist[MEM_STATS_BUCKETS];
+} RTX_MEM_STATS;
+
+/**
+ * @brief   deadline statistics of a real-time task, filled by tsk_get_rt_stats()
+ */
+typedef struct rtx_rt_stats {
+    U32     jobs;           /**> jobs that called tsk_done_rt                     */
+    U32     misses;         /**> deadlines that passed with the job still running */
+    TIMEVAL worst_response; /**> longest release to tsk_done_rt, in whole ticks  */
+    U8      policy;         /**> MISS_* policy of the task                        */
+    task_t  supervisor;     /**> gets the RT_MISS messages under MISS_NOTIFY      */
+} RTX_RT_STATS;
+
+/**
+ * @brief   body of an RT_MISS message
+ */
+typedef struct rt_miss_info {
+    task_t  tid;            /**> task whose job missed its deadline               */
+    U32     misses;         /**> misses of the task so far, this one included     */
+    TIMEVAL deadline;       /**> the deadline that passed, time since boot        */
+} RT_MISS_INFO;
+
 
 
  /*
@@ -73,6 +138,7 @@
   *===========================================================================
   */
 
+#endif // ! COMMON_EXT_H_
 
  /*
   *===========================================================================
@@ -69,6 +69,10 @@ extern int k_mem_init(void);
 #define mem_init() _mem_init((U32)k_mem_init)
 extern int _mem_init(U32 p_func) __SVC_0;
 
+extern int k_mem_init_algo(int algo);
+#define mem_init_algo(algo) _mem_init_algo((U32)k_mem_init_algo, algo)
+extern int _mem_init_algo(U32 p_func, int algo) __SVC_0;
+
 extern void *k_mem_alloc(size_t size);
 #define mem_alloc(size) _mem_alloc((U32)k_mem_alloc, size)
 extern void *_mem_alloc(U32 p_func, size_t size) __SVC_0;
@@ -77,10 +81,59 @@ extern int k_mem_dealloc(void *);
 #define mem_dealloc(ptr) _mem_dealloc((U32)k_mem_dealloc, ptr)
 extern int _mem_dealloc(U32 p_func, void *ptr) __SVC_0;
 
+extern void *k_mem_realloc(void *ptr, size_t size);
+#define mem_realloc(ptr, size) _mem_realloc((U32)k_mem_realloc, ptr, size)
+extern void *_mem_realloc(U32 p_func, void *ptr, size_t size) __SVC_0;
+
+extern void *k_mem_alloc_aligned(size_t size, size_t align);
+#define mem_alloc_aligned(size, align) _mem_alloc_aligned((U32)k_mem_alloc_aligned, size, align)
+extern void *_mem_alloc_aligned(U32 p_func, size_t size, size_t align) __SVC_0;
+
+extern int k_mem_alloc_n(size_t size, int count, void **ptrs);
+#define mem_alloc_n(size, count, ptrs) _mem_alloc_n((U32)k_mem_alloc_n, size, count, ptrs)
+extern int _mem_alloc_n(U32 p_func, size_t size, int count, void **ptrs) __SVC_0;
+
+extern int k_mem_dealloc_n(void **ptrs, int count);
+#define mem_dealloc_n(ptrs, count) _mem_dealloc_n((U32)k_mem_dealloc_n, ptrs, count)
+extern int _mem_dealloc_n(U32 p_func, void **ptrs, int count) __SVC_0;
+
 extern int k_mem_count_extfrag(size_t size);
 #define mem_count_extfrag(size) _mem_count_extfrag((U32)k_mem_count_extfrag, size)
 extern int _mem_count_extfrag(U32 p_func, size_t size) __SVC_0;
 
+extern int k_mem_get_stats(RTX_MEM_STATS *buffer);
+#define mem_get_stats(buffer) _mem_get_stats((U32)k_mem_get_stats, buffer)
+extern int _mem_get_stats(U32 p_func, RTX_MEM_STATS *buffer) __SVC_0;
+
+extern int k_mem_trace_dump(void);
+#define mem_trace_dump() _mem_trace_dump((U32)k_mem_trace_dump)
+extern int _mem_trace_dump(U32 p_func) __SVC_0;
+
+extern int k_mem_check(void);
+#define mem_check() _mem_check((U32)k_mem_check)
+extern int _mem_check(U32 p_func) __SVC_0;
+
+extern int k_mem_dump_task(task_t tid);
+#define mem_dump_task(tid) _mem_dump_task((U32)k_mem_dump_task, tid)
+extern int _mem_dump_task(U32 p_func, task_t tid) __SVC_0;
+
+/* fixed size block pools */
+extern int k_mem_pool_create(size_t blk_size, size_t num_blks);
+#define mem_pool_create(blk_size, num_blks) _mem_pool_create((U32)k_mem_pool_create, blk_size, num_blks)
+extern int _mem_pool_create(U32 p_func, size_t blk_size, size_t num_blks) __SVC_0;
+
+extern void *k_mem_pool_alloc(int pool_id);
+#define mem_pool_alloc(pool_id) _mem_pool_alloc((U32)k_mem_pool_alloc, pool_id)
+extern void *_mem_pool_alloc(U32 p_func, int pool_id) __SVC_0;
+
+extern int k_mem_pool_dealloc(int pool_id, void *ptr);
+#define mem_pool_dealloc(pool_id, ptr) _mem_pool_dealloc((U32)k_mem_pool_dealloc, pool_id, ptr)
+extern int _mem_pool_dealloc(U32 p_func, int pool_id, void *ptr) __SVC_0;
+
+extern int k_mem_pool_delete(int pool_id);
+#define mem_pool_delete(pool_id) _mem_pool_delete((U32)k_mem_pool_delete, pool_id)
+extern int _mem_pool_delete(U32 p_func, int pool_id) __SVC_0;
+
 /*------------------------------------------------------------------------*
  * System Initialization Function(s) - LAB2, LAB4, LAB5
  *------------------------------------------------------------------------*/
@@ -127,8 +180,12 @@ extern task_t k_tsk_get_tid(void);
 #define tsk_get_tid() _tsk_get_tid((U32)k_tsk_get_tid)
 extern task_t __SVC_0 _tsk_get_tid(U32 p_func);
 
+extern int k_tsk_get_stack_use(task_t task_id, U16 *k_used, U16 *u_used);
+#define tsk_get_stack_use(task_id, k_used, u_used) _tsk_get_stack_use((U32)k_tsk_get_stack_use, task_id, k_used, u_used)
+extern int __SVC_0 _tsk_get_stack_use(U32 p_func, task_t task_id, U16 *k_used, U16 *u_used);
+
 extern int k_tsk_ls(task_t *buf, int count);
-#define tsk_ls(buf, count) _tsk_ls((U32)k_tsk_ls, buf, count);
+#define tsk_ls(buf, count) _tsk_ls((U32)k_tsk_ls, buf, count)
 extern int __SVC_0 _tsk_ls(U32 p_func, task_t *buf, int count);
 
 /*------------------------------------------------------------------------*
@@ -147,6 +204,14 @@ extern void k_tsk_suspend(TIMEVAL *tv);
 #define tsk_suspend(tv) _tsk_suspend((U32) k_tsk_suspend, tv)
 extern void __SVC_0 _tsk_suspend(U32 p_func, TIMEVAL *tv);
 
+extern int k_tsk_set_miss_policy(task_t task_id, U8 policy, task_t supervisor);
+#define tsk_set_miss_policy(task_id, policy, supervisor) _tsk_set_miss_policy((U32)k_tsk_set_miss_policy, task_id, policy, supervisor)
+extern int __SVC_0 _tsk_set_miss_policy(U32 p_func, task_t task_id, U8 policy, task_t supervisor);
+
+extern int k_tsk_get_rt_stats(task_t task_id, RTX_RT_STATS *buffer);
+#define tsk_get_rt_stats(task_id, buffer) _tsk_get_rt_stats((U32)k_tsk_get_rt_stats, task_id, buffer)
+extern int __SVC_0 _tsk_get_rt_stats(U32 p_func, task_t task_id, RTX_RT_STATS *buffer);
+
 
 /*------------------------------------------------------------------------*
  * Interprocess Communication Functions - LAB3, LAB4
@@ -169,7 +234,7 @@ extern int k_recv_msg_nb(task_t *tid, void *buf, size_t len);
 extern int __SVC_0 _recv_msg_nb(U32 p_func, task_t *tid, void *buf, size_t len);
 
 extern int k_mbx_ls(task_t *buf, int count);
-#define mbx_ls(buf, count) _mbx_ls((U32)k_mbx_ls, buf, count);
+#define mbx_ls(buf, count) _mbx_ls((U32)k_mbx_ls, buf, count)
 extern int __SVC_0 _mbx_ls(U32 p_func, task_t *buf, int count);
 
 /*------------------------------------------------------------------------*
@@ -59,6 +59,26 @@ int ae_set_sys_info(RTX_SYS_INFO *sys_info) {
 
     // Scheduling sys info set up, only do DEFAULT in lab2
     sys_info->sched = DEFAULT;
+#if TEST == 11
+    sys_info->sched = EDF;
+    sys_info->rtx_time_qtm = MIN_RTX_QTM;
+#endif
+#if TEST == 12
+    sys_info->sched = RM_PS;
+    sys_info->rtx_time_qtm = MIN_RTX_QTM;
+    sys_info->server.p_n.sec = 0;
+    sys_info->server.p_n.usec = 10000;
+    sys_info->server.b_n.sec = 0;
+    sys_info->server.b_n.usec = 2000;
+#endif
+#if TEST == 13
+    sys_info->sched = RM_NPS;
+    sys_info->rtx_time_qtm = 1000;
+#endif
+#if TEST == 14
+    sys_info->sched = EDF;
+    sys_info->rtx_time_qtm = MIN_RTX_QTM;
+#endif
 
     return RTX_OK;
 }
@@ -188,6 +208,198 @@ void ae_set_task_info(RTX_TASK_INFO *tasks, int num_tasks) {
 
 #endif
 
+#if TEST == 5
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_05!\r\n");
+    printf("Info: Initializing system with one user task that spawns a leaky worker!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 6
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_06!\r\n");
+    printf("Info: Initializing system with one user task using an allocation cache!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x800;
+
+#endif
+
+#if TEST == 7
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_07!\r\n");
+    printf("Info: Initializing system with one user task measuring stack use!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 8
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_08!\r\n");
+    printf("Info: Initializing system with one user task on a 0x400 byte kernel stack!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x400;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 9
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_09!\r\n");
+    printf("Info: Initializing system with two user tasks timing the scheduler!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+	tasks[1].prio = MEDIUM;
+	tasks[1].priv = 0;
+	tasks[1].ptask = &utask2;
+	tasks[1].k_stack_size = 0x200;
+	tasks[1].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 10
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_10!\r\n");
+    printf("Info: Initializing system with one user task listing tids!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 11
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_11!\r\n");
+    printf("Info: Initializing system with two real-time tasks under EDF and one background task!\r\n");
+
+    tasks[0].prio = PRIO_RT;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+	tasks[0].p_n.sec = 0;
+	tasks[0].p_n.usec = 5000;
+	tasks[0].c_n.sec = 0;
+	tasks[0].c_n.usec = 1000;
+
+	tasks[1].prio = PRIO_RT;
+	tasks[1].priv = 0;
+	tasks[1].ptask = &utask2;
+	tasks[1].k_stack_size = 0x200;
+	tasks[1].u_stack_size = 0x200;
+	tasks[1].p_n.sec = 0;
+	tasks[1].p_n.usec = 2000;
+	tasks[1].c_n.sec = 0;
+	tasks[1].c_n.usec = 500;
+
+	tasks[2].prio = MEDIUM;
+	tasks[2].priv = 0;
+	tasks[2].ptask = &utask3;
+	tasks[2].k_stack_size = 0x200;
+	tasks[2].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 12
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_12!\r\n");
+    printf("Info: Initializing system with one real-time task and two tasks on a polling server!\r\n");
+
+    tasks[0].prio = PRIO_RT;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+	tasks[0].p_n.sec = 0;
+	tasks[0].p_n.usec = 4000;
+	tasks[0].c_n.sec = 0;
+	tasks[0].c_n.usec = 500;
+
+	tasks[1].prio = MEDIUM;
+	tasks[1].priv = 0;
+	tasks[1].ptask = &utask2;
+	tasks[1].k_stack_size = 0x200;
+	tasks[1].u_stack_size = 0x200;
+
+	tasks[2].prio = HIGH;
+	tasks[2].priv = 0;
+	tasks[2].ptask = &utask3;
+	tasks[2].k_stack_size = 0x200;
+	tasks[2].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 13
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_13!\r\n");
+    printf("Info: Initializing system with one task that creates real-time tasks under RM!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
+#if TEST == 14
+
+    printf("============================================\r\n");
+    printf("============================================\r\n");
+    printf("Info: Starting T_14!\r\n");
+    printf("Info: Initializing system with one task that supervises late real-time jobs!\r\n");
+
+    tasks[0].prio = MEDIUM;
+	tasks[0].priv = 0;
+	tasks[0].ptask = &utask1;
+	tasks[0].k_stack_size = 0x200;
+	tasks[0].u_stack_size = 0x200;
+
+#endif
+
 
 }
 
@@ -72,6 +72,46 @@ extern task_t ktid3;
 	#define BOOT_TASKS 2
 #endif
 
+#if TEST == 5
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 6
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 7
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 8
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 9
+	#define BOOT_TASKS 2
+#endif
+
+#if TEST == 10
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 11
+	#define BOOT_TASKS 3
+#endif
+
+#if TEST == 12
+	#define BOOT_TASKS 3
+#endif
+
+#if TEST == 13
+	#define BOOT_TASKS 1
+#endif
+
+#if TEST == 14
+	#define BOOT_TASKS 1
+#endif
+
 /*
  *===========================================================================
  *                            FUNCTION PROTOTYPES
@@ -567,6 +567,1081 @@ int test_mem(void) {
 	return firstWithLast();
 }
 
+#endif
+#if TEST == 105
+/* first fit vs TLSF timing comparison, run it with the default DEBUG settings (no DEBUG_0) */
+
+#define N 5000
+#define S 3
+#define FRAGMENTS 2000
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+/* same mixed small request mix as TEST 102, returns the average time of S rounds in us */
+unsigned int throughput_round(int algo) {
+	void *p[10];
+	unsigned int sizes[10] = {4, 8, 12, 16, 24, 32, 64, 4, 12, 8};
+	unsigned int total = 0;
+
+	for (int j = 0; j < S; j++) {
+		k_mem_init_algo(algo);
+		unsigned int start = timer_get_current_val(2);
+		for (int i = 0; i < N; i++) {
+			for (int k = 0; k < 10; k++) {
+				p[k] = k_mem_alloc(sizes[k]);
+			}
+			for (int k = 0; k < 10; k++) {
+				k_mem_dealloc(p[k]);
+			}
+		}
+		unsigned int end = timer_get_current_val(2);
+		total += start - end;
+	}
+	return total / S;
+}
+
+/*
+ * worst case latency on a fragmented heap: every other small block is freed so the
+ * free list holds FRAGMENTS holes that are too small, then we time a single large request
+ * and the dealloc that has to coalesce it back
+ */
+int fragmented_round(int algo, unsigned int *alloc_us, unsigned int *dealloc_us) {
+	static void *p[2 * FRAGMENTS];
+
+	k_mem_init_algo(algo);
+	for (int i = 0; i < 2 * FRAGMENTS; i++) {
+		p[i] = k_mem_alloc(32);
+		if (p[i] == NULL) {
+			return RTX_ERR;
+		}
+	}
+	for (int i = 0; i < 2 * FRAGMENTS; i += 2) {
+		k_mem_dealloc(p[i]);
+	}
+
+	unsigned int start = timer_get_current_val(2);
+	void *big = k_mem_alloc(4096);
+	unsigned int end = timer_get_current_val(2);
+	*alloc_us = start - end;
+
+	start = timer_get_current_val(2);
+	k_mem_dealloc(big);
+	end = timer_get_current_val(2);
+	*dealloc_us = start - end;
+
+	for (int i = 1; i < 2 * FRAGMENTS; i += 2) {
+		k_mem_dealloc(p[i]);
+	}
+	return (big == NULL) ? RTX_ERR : RTX_OK;
+}
+
+int tlsf_timing_test() {
+	unsigned int ff_alloc_us, ff_dealloc_us, tlsf_alloc_us, tlsf_dealloc_us;
+
+	printf("Avg of %d rounds, %d x (10 alloc + 10 dealloc):\r\n", S, N);
+	printf("  FIRST_FIT: %u us\r\n", throughput_round(FIRST_FIT));
+	printf("  TLSF:      %u us\r\n", throughput_round(TLSF));
+
+	if (fragmented_round(FIRST_FIT, &ff_alloc_us, &ff_dealloc_us) != RTX_OK
+			|| fragmented_round(TLSF, &tlsf_alloc_us, &tlsf_dealloc_us) != RTX_OK) {
+		printf("Err: fragmented heap scenario could not allocate.\r\n");
+		k_mem_init();
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	printf("Large request behind %d free holes:\r\n", FRAGMENTS);
+	printf("  FIRST_FIT: alloc %u us, dealloc %u us\r\n", ff_alloc_us, ff_dealloc_us);
+	printf("  TLSF:      alloc %u us, dealloc %u us\r\n", tlsf_alloc_us, tlsf_dealloc_us);
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+
+	return tlsf_timing_test();
+}
+
+#endif
+#if TEST == 106
+/* boundary tag checks: bad pointers are rejected and both neighbours coalesce, for every algorithm */
+
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+int boundary_tag_round(int algo) {
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	char *p1 = k_mem_alloc(40);
+	char *p2 = k_mem_alloc(40);
+	char *p3 = k_mem_alloc(40);
+	char *p4 = k_mem_alloc(40);
+	unsigned int block_size = (unsigned int)p2 - (unsigned int)p1;
+
+	if (k_mem_dealloc(p2 + 8) == RTX_OK) {
+		printf("Err: algo %d freed a pointer into the middle of a block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_dealloc((void *)0x100) == RTX_OK) {
+		printf("Err: algo %d freed a pointer outside the heap.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_mem_dealloc(p1);
+	k_mem_dealloc(p3);
+	if (k_mem_dealloc(p3) == RTX_OK) {
+		printf("Err: algo %d accepted a double free.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	/* p2 has a free block on both sides, the three of them must become one */
+	k_mem_dealloc(p2);
+	if (k_mem_dealloc(p2) == RTX_OK || k_mem_dealloc(p1) == RTX_OK) {
+		printf("Err: algo %d accepted a free of a block that was merged away.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_count_extfrag(3 * block_size) != 0 || k_mem_count_extfrag(3 * block_size + 1) != 1) {
+		printf("Err: algo %d did not coalesce with both neighbours.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_mem_dealloc(p4);
+	if (k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d did not end up with a single free block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = boundary_tag_round(FIRST_FIT) && boundary_tag_round(BEST_FIT) && boundary_tag_round(TLSF);
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Boundary tag test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 107
+/* fixed size pools: correctness, then timing against k_mem_alloc for a message sized block */
+
+#define N 5000
+#define BLOCKS 10
+#define MSG_BLK_SIZE (sizeof(RTX_MSG_HDR) + 16)
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+int pool_correctness() {
+	void *p[BLOCKS];
+	int pool = k_mem_pool_create(MSG_BLK_SIZE, BLOCKS);
+	if (pool < 0) {
+		printf("Err: pool could not be created.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	for (int i = 0; i < BLOCKS; i++) {
+		p[i] = k_mem_pool_alloc(pool);
+		if (p[i] == NULL || ((unsigned int)p[i] & 7) != 0) {
+			printf("Err: pool alloc %d returned 0x%x.\r\n", i, p[i]);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+	}
+	if (k_mem_pool_alloc(pool) != NULL) {
+		printf("Err: pool handed out more blocks than it has.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	if (k_mem_pool_dealloc(pool, (char *)p[3] + 4) == RTX_OK) {
+		printf("Err: pool accepted a pointer into the middle of a block.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_pool_dealloc(pool, p[3]) != RTX_OK || k_mem_pool_dealloc(pool, p[3]) == RTX_OK) {
+		printf("Err: pool dealloc or double free check failed.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_pool_alloc(pool) != p[3]) {
+		printf("Err: pool did not reuse the freed block.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	if (k_mem_pool_delete(pool) != RTX_OK || k_mem_pool_alloc(pool) != NULL) {
+		printf("Err: pool delete failed.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int pool_timing() {
+	void *p[BLOCKS];
+	int pool = k_mem_pool_create(MSG_BLK_SIZE, BLOCKS);
+	if (pool < 0) {
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	unsigned int start = timer_get_current_val(2);
+	for (int i = 0; i < N; i++) {
+		for (int k = 0; k < BLOCKS; k++) {
+			p[k] = k_mem_alloc(MSG_BLK_SIZE);
+		}
+		for (int k = 0; k < BLOCKS; k++) {
+			k_mem_dealloc(p[k]);
+		}
+	}
+	unsigned int heap_us = start - timer_get_current_val(2);
+
+	start = timer_get_current_val(2);
+	for (int i = 0; i < N; i++) {
+		for (int k = 0; k < BLOCKS; k++) {
+			p[k] = k_mem_pool_alloc(pool);
+		}
+		for (int k = 0; k < BLOCKS; k++) {
+			k_mem_pool_dealloc(pool, p[k]);
+		}
+	}
+	unsigned int pool_us = start - timer_get_current_val(2);
+
+	k_mem_pool_delete(pool);
+	printf("%d x (%d alloc + %d dealloc) of %u bytes:\r\n", N, BLOCKS, BLOCKS, MSG_BLK_SIZE);
+	printf("  heap: %u us\r\n", heap_us);
+	printf("  pool: %u us\r\n", pool_us);
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = pool_correctness() && pool_timing();
+	if (result) {
+		printf("Pool test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 108
+/* stack region: a freed stack is handed straight back, and stacks sit next to each other instead of spreading over the heap */
+
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+/* kernel only, there are no system calls for these */
+extern void *k_slab_alloc(size_t size);
+extern int k_slab_dealloc(void *ptr, size_t size);
+extern int k_slab_shrink(void);
+
+int slab_test() {
+	// plain first fit, SEG_FIT would keep the small block below cached after it is freed
+	k_mem_init_algo(FIRST_FIT);
+	void *s1 = k_slab_alloc(U_STACK_SIZE);
+	void *user = k_mem_alloc(40);
+	void *s2 = k_slab_alloc(U_STACK_SIZE);
+
+	if (s1 == NULL || s2 == NULL || user == NULL) {
+		printf("Err: allocation failed.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if ((unsigned int)s2 != (unsigned int)s1 + U_STACK_SIZE) {
+		printf("Err: stacks are not packed in one slab, s1 0x%x s2 0x%x.\r\n", s1, s2);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_slab_dealloc(s1, U_STACK_SIZE);
+	if (k_slab_alloc(U_STACK_SIZE) != s1) {
+		printf("Err: freed stack was not reused.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_slab_dealloc(s1, U_STACK_SIZE);
+	k_slab_dealloc(s2, U_STACK_SIZE);
+	k_mem_dealloc(user);
+	k_slab_shrink();
+	if (k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: empty slabs were not returned to the heap.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = slab_test();
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Slab test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 109
+/* allocator statistics, build the kernel with MEM_STATS defined */
+
+#define N 1000
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void print_hist(char *name, unsigned int *hist) {
+	printf("%s latency:\r\n", name);
+	for (int i = 0; i < MEM_STATS_BUCKETS; i++) {
+		if (hist[i] != 0) {
+			printf("  < %u us: %u\r\n", 1U << i, hist[i]);
+		}
+	}
+}
+
+int stats_test() {
+	RTX_MEM_STATS stats;
+	void *p[10];
+	unsigned int sizes[10] = {4, 8, 12, 16, 24, 32, 64, 4, 12, 8};
+
+	k_mem_init();
+	for (int i = 0; i < N; i++) {
+		for (int k = 0; k < 10; k++) {
+			p[k] = k_mem_alloc(sizes[k]);
+		}
+		for (int k = 0; k < 10; k += 2) {
+			k_mem_dealloc(p[k]);
+		}
+	}
+
+	if (k_mem_get_stats(&stats) != RTX_OK) {
+		printf("Err: no statistics, was the kernel built with MEM_STATS?\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	printf("alloc %u (failed %u), dealloc %u\r\n", stats.alloc_count, stats.alloc_fail_count, stats.dealloc_count);
+	printf("in use %u bytes, high water mark %u bytes\r\n", stats.bytes_in_use, stats.bytes_hwm);
+	printf("%u free blocks, %u bytes, largest %u bytes\r\n", stats.free_blocks, stats.free_bytes, stats.largest_free);
+	print_hist("alloc", stats.alloc_hist);
+	print_hist("dealloc", stats.dealloc_hist);
+
+	// every round keeps 72 bytes once padded, a block can be a bit bigger when the hole it came from was not worth splitting
+	if (stats.alloc_count != 10 * N || stats.dealloc_count != 5 * N || stats.bytes_in_use < 72 * N
+			|| stats.bytes_hwm < stats.bytes_in_use) {
+		printf("Err: counters do not match the workload.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = stats_test();
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	return result;
+}
+
+#endif
+#if TEST == 110
+/*
+ * allocation trace, build the kernel with MEM_TRACE defined.
+ * capture the console output to a file and replay it with RTX/tools/mem_replay
+ */
+
+#define N 200
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+int trace_test() {
+	void *p[10];
+	unsigned int sizes[10] = {4, 8, 12, 16, 24, 32, 64, 4, 12, 8};
+
+	k_mem_init();
+	for (int i = 0; i < N; i++) {
+		for (int k = 0; k < 10; k++) {
+			p[k] = k_mem_alloc(sizes[k] * (i % 7 + 1));
+		}
+		for (int k = 0; k < 10; k += 1 + (i & 1)) {
+			k_mem_dealloc(p[k]);
+		}
+	}
+
+	// one init, 10 * N allocs and 7.5 deallocs per round on average, plus whatever ran before the test
+	int count = k_mem_trace_dump();
+	if (count == RTX_ERR) {
+		printf("Err: no trace, was the kernel built with MEM_TRACE?\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (count < 1 + 10 * N + 15 * N / 2) {
+		printf("Err: expected %d records, dumped %d.\r\n", 1 + 10 * N + 15 * N / 2, count);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = trace_test();
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	return result;
+}
+
+#endif
+#if TEST == 111
+/*
+ * per block overhead and how many small objects fit in the heap, compared with the
+ * 24 byte header + footer every block used to carry.
+ * the default build has 16 byte headers, build the kernel with MEM_SMALL_HEADER to see 8 bytes
+ */
+
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+#define OLD_OVERHEAD 24
+
+int capacity_round(int algo, unsigned int size) {
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	char *first = k_mem_alloc(size);
+	char *second = k_mem_alloc(size);
+	unsigned int overhead = (unsigned int)second - (unsigned int)first - PAD(size);
+
+	// fill the heap, then put every block back
+	char *last = second;
+	unsigned int count = 2;
+	char *p;
+	while ((p = k_mem_alloc(size)) != NULL) {
+		*(char **)p = last;
+		last = p;
+		count++;
+	}
+
+	unsigned int heap = k_mem_get_split() - PAD((unsigned int)&Image$$ZI_DATA$$ZI$$Limit);
+	unsigned int old_count = heap / (PAD(size) + OLD_OVERHEAD);
+	printf("algo %d, %2u byte objects: %2u bytes overhead, %u fit (%u with the old layout, +%u%%)\r\n",
+			algo, size, overhead, count, old_count, (count - old_count) * 100 / old_count);
+
+	while (last != second) {
+		p = *(char **)last;
+		if (k_mem_dealloc(last) != RTX_OK) {
+			printf("Err: algo %d could not free 0x%x.\r\n", algo, last);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+		last = p;
+	}
+	k_mem_dealloc(second);
+	k_mem_dealloc(first);
+
+	if (overhead > 16 || count <= old_count || k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d, %u byte objects did not get the smaller header.\r\n", algo, size);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	unsigned int sizes[3] = {8, 16, 24};
+	int result = MANUAL_UNIT_TEST_OK;
+
+	for (int i = 0; i < 3; i++) {
+		result = result && capacity_round(FIRST_FIT, sizes[i]) && capacity_round(BEST_FIT, sizes[i])
+				&& capacity_round(TLSF, sizes[i]);
+	}
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Header capacity test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 112
+/*
+ * SEG_FIT size classes: small blocks come from their class list and sit next to
+ * each other, and the median small allocation does not depend on how long the
+ * first fit free list has become
+ */
+
+#define HOLES 500
+#define SAMPLES 101
+#define BATCH 10
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void *g_keep[HOLES];
+
+/* free list of HOLES small holes in front of any block a 24 byte request fits in */
+void fragment_heap(void) {
+	void *hole[HOLES];
+	for (int i = 0; i < HOLES; i++) {
+		hole[i] = k_mem_alloc(8);
+		g_keep[i] = k_mem_alloc(8);
+	}
+	for (int i = 0; i < HOLES; i++) {
+		k_mem_dealloc(hole[i]);
+	}
+}
+
+unsigned int median_us(void) {
+	unsigned int t[SAMPLES];
+	void *p[BATCH];
+
+	for (int i = 0; i < SAMPLES; i++) {
+		unsigned int start = timer_get_current_val(2);
+		for (int k = 0; k < BATCH; k++) {
+			p[k] = k_mem_alloc(24);
+		}
+		for (int k = 0; k < BATCH; k++) {
+			k_mem_dealloc(p[k]);
+		}
+		t[i] = start - timer_get_current_val(2);
+
+		/* insertion sort, the median is t[SAMPLES / 2] */
+		for (int j = i; j > 0 && t[j - 1] > t[j]; j--) {
+			unsigned int tmp = t[j];
+			t[j] = t[j - 1];
+			t[j - 1] = tmp;
+		}
+	}
+	return t[SAMPLES / 2];
+}
+
+int size_class_round(int algo) {
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return -1;
+	}
+	fragment_heap();
+	unsigned int us = median_us();
+	printf("algo %d: median %u us for %d x (alloc + dealloc) of 24 bytes, %d holes\r\n", algo, us, BATCH, HOLES);
+	return us;
+}
+
+int test_mem(void) {
+	int first_fit = size_class_round(FIRST_FIT);
+	int seg_fit = size_class_round(SEG_FIT);
+	int result = MANUAL_UNIT_TEST_OK;
+
+	if (first_fit < 0 || seg_fit < 0 || seg_fit > first_fit) {
+		printf("Err: size classes were not faster than first fit.\r\n");
+		result = MANUAL_UNIT_TEST_FAIL;
+	}
+
+	/* a fresh class carves neighbouring blocks */
+	char *a = k_mem_alloc(100);
+	char *b = k_mem_alloc(100);
+	char *c = k_mem_alloc(100);
+	if (b - a != c - b || b - a > 128 + 16) {
+		printf("Err: small blocks of one class are not packed, 0x%x 0x%x 0x%x.\r\n", a, b, c);
+		result = MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_mem_dealloc(b);
+	if (k_mem_dealloc(b) == RTX_OK || k_mem_alloc(100) != b) {
+		printf("Err: a cached block was freed twice or not reused.\r\n");
+		result = MANUAL_UNIT_TEST_FAIL;
+	}
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Size class test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 113
+/*
+ * fragmentation of each algorithm after the same mixed workload: task stacks and
+ * mailboxes, message sized blocks with the size mix of TEST 105/110, freed out of order.
+ * counts free blocks too small for a stack, a message and anything at all
+ */
+
+#define ROUNDS 200
+#define LIVE 64
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void *g_live[LIVE];
+
+int frag_round(int algo) {
+	unsigned int sizes[10] = {4, 8, 12, 16, 24, 32, 64, 4, 12, 8};
+	unsigned int seed = 1;
+
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	for (int i = 0; i < LIVE; i++) {
+		g_live[i] = NULL;
+	}
+
+	for (int i = 0; i < ROUNDS * LIVE; i++) {
+		seed = seed * 1103515245 + 12345; /* same sequence for every algorithm */
+		int slot = (seed >> 16) % LIVE;
+		if (g_live[slot] != NULL) {
+			k_mem_dealloc(g_live[slot]);
+		}
+		if ((seed >> 8) % 8 == 0) {
+			g_live[slot] = k_mem_alloc(U_STACK_SIZE << ((seed >> 12) % 3)); /* a stack or a mailbox */
+		} else {
+			g_live[slot] = k_mem_alloc(sizes[(seed >> 4) % 10] * ((seed >> 20) % 7 + 1) + sizeof(RTX_MSG_HDR));
+		}
+	}
+
+	printf("algo %d: free blocks %d, < stack %d, < message %d\r\n", algo,
+			k_mem_count_extfrag(0x7FFFFFFF), k_mem_count_extfrag(U_STACK_SIZE + 1), k_mem_count_extfrag(sizeof(RTX_MSG_HDR) + 33));
+
+	for (int i = 0; i < LIVE; i++) {
+		k_mem_dealloc(g_live[i]);
+	}
+	if (algo != SEG_FIT && k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d did not end up with a single free block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = frag_round(FIRST_FIT) && frag_round(BEST_FIT) && frag_round(TLSF) && frag_round(SEG_FIT);
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Fragmentation comparison done.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 114
+/*
+ * stack region: stack and mailbox churn stays out of the heap, and once everything
+ * is freed the region merges back into one block as big as the region
+ */
+
+#define TASKS 40
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+/* kernel only, there are no system calls for these */
+extern void *k_slab_alloc(size_t size);
+extern int k_slab_dealloc(void *ptr, size_t size);
+extern int k_slab_shrink(void);
+
+void *g_stack[TASKS];
+void *g_mbx[TASKS];
+
+int stack_region_test() {
+	RTX_SYS_INFO info;
+	k_get_sys_info(&info);
+	unsigned int region = RAM_END + 1 - info.mem_split;
+	printf("heap 0x%x - 0x%x, stack region 0x%x - 0x%x\r\n", PAD((unsigned int)&Image$$ZI_DATA$$ZI$$Limit),
+			info.mem_split, info.mem_split, info.mem_split + region);
+
+	void *data = k_mem_alloc(100);
+	int frag = k_mem_count_extfrag(0x7FFFFFFF);
+
+	/* tasks with growing stacks and odd sized mailboxes come and go */
+	for (int round = 0; round < 20; round++) {
+		for (int i = round & 1; i < TASKS; i += 2) {
+			k_slab_dealloc(g_stack[i], U_STACK_SIZE << (i % 3));
+			k_slab_dealloc(g_mbx[i], 40 + 24 * (i % 5));
+			g_stack[i] = k_slab_alloc(U_STACK_SIZE << (i % 3));
+			g_mbx[i] = k_slab_alloc(40 + 24 * (i % 5));
+			if ((unsigned int)g_stack[i] < info.mem_split || (unsigned int)g_mbx[i] < info.mem_split) {
+				printf("Err: round %d task %d got memory outside the stack region.\r\n", round, i);
+				return MANUAL_UNIT_TEST_FAIL;
+			}
+		}
+	}
+	if (k_mem_count_extfrag(0x7FFFFFFF) != frag) {
+		printf("Err: stack churn changed the heap.\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	for (int i = 0; i < TASKS; i++) {
+		k_slab_dealloc(g_stack[i], U_STACK_SIZE << (i % 3));
+		k_slab_dealloc(g_mbx[i], 40 + 24 * (i % 5));
+	}
+	k_slab_shrink();
+	void *all = k_slab_alloc(region);
+	if (all != (void *)info.mem_split) {
+		printf("Err: the stack region did not merge back into one block, got 0x%x.\r\n", all);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	k_slab_dealloc(all, region);
+	k_mem_dealloc(data);
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	k_mem_init();
+	int result = stack_region_test();
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Stack region test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 115
+/*
+ * mem_realloc: grows into a free neighbour and shrinks without moving,
+ * moves with its contents when it has to, NULL and size 0 act like alloc and dealloc
+ */
+
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void fill(unsigned char *p, unsigned int size, unsigned char seed) {
+	for (unsigned int i = 0; i < size; i++) {
+		p[i] = (unsigned char)(seed + i);
+	}
+}
+
+int check(unsigned char *p, unsigned int size, unsigned char seed) {
+	for (unsigned int i = 0; i < size; i++) {
+		if (p[i] != (unsigned char)(seed + i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int realloc_round(int algo) {
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	/* bigger than the SEG_FIT size classes so b really becomes free */
+	unsigned char *a = k_mem_alloc(200);
+	unsigned char *b = k_mem_alloc(200);
+	unsigned char *c = k_mem_alloc(200);
+	fill(a, 200, 1);
+	k_mem_dealloc(b);
+
+	unsigned char *p = k_mem_realloc(a, 300);
+	if (p != a || !check(p, 200, 1)) {
+		printf("Err: algo %d did not grow into the free block after it.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	fill(p, 300, 2);
+
+	p = k_mem_realloc(a, 40);
+	if (p != a || !check(p, 40, 2)) {
+		printf("Err: algo %d did not shrink in place.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	/* c is in the way now */
+	p = k_mem_realloc(a, 2000);
+	if (p == NULL || p == a || !check(p, 40, 2)) {
+		printf("Err: algo %d did not move the block with its contents.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_dealloc(a) == RTX_OK) {
+		printf("Err: algo %d left the old block allocated.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	if (k_mem_realloc(p + 4, 100) != NULL) {
+		printf("Err: algo %d accepted a pointer into the middle of a block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (k_mem_realloc(p, 0) != NULL || k_mem_dealloc(p) == RTX_OK) {
+		printf("Err: algo %d did not free on size 0.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	p = k_mem_realloc(NULL, 100);
+	if (p == NULL) {
+		printf("Err: algo %d did not allocate for NULL.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	k_mem_dealloc(p);
+	k_mem_dealloc(c);
+	if (algo != SEG_FIT && k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d did not end up with a single free block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = realloc_round(FIRST_FIT) && realloc_round(BEST_FIT) && realloc_round(TLSF) && realloc_round(SEG_FIT);
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Realloc test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 116
+/*
+ * mem_alloc_aligned: blocks start on the requested boundary, the slack around them
+ * goes back to the heap, and everything merges back into one block once freed
+ */
+
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+int aligned_round(int algo) {
+	unsigned int aligns[6] = {8, 16, 32, 64, 256, 4096};
+	unsigned char *p[6];
+
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	void *odd = k_mem_alloc(12); /* so the heap does not start out aligned */
+	for (int i = 0; i < 6; i++) {
+		p[i] = k_mem_alloc_aligned(100 + 40 * i, aligns[i]);
+		if (p[i] == NULL || ((unsigned int)p[i] & (aligns[i] - 1)) != 0) {
+			printf("Err: algo %d gave 0x%x for alignment %d.\r\n", algo, p[i], aligns[i]);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+		for (int j = 0; j < 100 + 40 * i; j++) {
+			p[i][j] = i;
+		}
+	}
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 100 + 40 * i; j++) {
+			if (p[i][j] != i) {
+				printf("Err: algo %d block %d was overwritten.\r\n", algo, i);
+				return MANUAL_UNIT_TEST_FAIL;
+			}
+		}
+	}
+
+	if (k_mem_alloc_aligned(100, 0) != NULL || k_mem_alloc_aligned(100, 48) != NULL || k_mem_alloc_aligned(0, 32) != NULL) {
+		printf("Err: algo %d accepted a bad size or alignment.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	for (int i = 0; i < 6; i++) {
+		if (k_mem_dealloc(p[i]) != RTX_OK) {
+			printf("Err: algo %d could not free block %d.\r\n", algo, i);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+	}
+	k_mem_dealloc(odd);
+	if (algo != SEG_FIT && k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d did not end up with a single free block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = aligned_round(FIRST_FIT) && aligned_round(BEST_FIT) && aligned_round(TLSF) && aligned_round(SEG_FIT);
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Aligned alloc test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 117
+/*
+ * mem_alloc_n / mem_dealloc_n: a burst comes out of one block on a fresh heap,
+ * a batch with a bad entry frees nothing, and a shuffled batch coalesces completely
+ */
+
+#define BURST 16
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void *g_burst[BURST];
+
+int batch_round(int algo, unsigned int size) {
+	if (k_mem_init_algo(algo) != RTX_OK) {
+		printf("Err: algo %d could not init.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	if (k_mem_alloc_n(size, BURST, g_burst) != RTX_OK) {
+		printf("Err: algo %d could not allocate %d blocks of %d bytes.\r\n", algo, BURST, size);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	for (int i = 0; i < BURST; i++) {
+		for (unsigned int j = 0; j < size; j++) {
+			((unsigned char *)g_burst[i])[j] = i;
+		}
+	}
+	for (int i = 0; i < BURST; i++) {
+		for (unsigned int j = 0; j < size; j++) {
+			if (((unsigned char *)g_burst[i])[j] != i) {
+				printf("Err: algo %d blocks %d overlaps another one.\r\n", algo, i);
+				return MANUAL_UNIT_TEST_FAIL;
+			}
+		}
+		if (algo != SEG_FIT && i > 0 && g_burst[i] <= g_burst[i - 1]) {
+			printf("Err: algo %d did not cut the burst from one block.\r\n", algo);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+	}
+
+	/* shuffle, and put one block in twice */
+	for (int i = 0; i < BURST / 2; i++) {
+		void *tmp = g_burst[i];
+		g_burst[i] = g_burst[BURST - 1 - i];
+		g_burst[BURST - 1 - i] = tmp;
+	}
+	void *dup = g_burst[3];
+	g_burst[3] = g_burst[7];
+	int frag = k_mem_count_extfrag(0x7FFFFFFF);
+	if (k_mem_dealloc_n(g_burst, BURST) == RTX_OK || k_mem_count_extfrag(0x7FFFFFFF) != frag) {
+		printf("Err: algo %d freed a batch with a block in it twice.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	for (int i = 1; i < BURST; i++) { /* it came back sorted, so the two copies are next to each other */
+		if (g_burst[i] == g_burst[i - 1]) {
+			g_burst[i] = dup;
+		}
+	}
+	if (k_mem_dealloc_n(g_burst, BURST) != RTX_OK) {
+		printf("Err: algo %d could not free the batch.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	for (int i = 1; i < BURST; i++) {
+		if (g_burst[i] < g_burst[i - 1]) {
+			printf("Err: algo %d did not sort the batch.\r\n", algo);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+	}
+	if (k_mem_dealloc_n(g_burst, BURST) == RTX_OK) {
+		printf("Err: algo %d freed the batch twice.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	if (algo != SEG_FIT && k_mem_count_extfrag(0x7FFFFFFF) != 1) {
+		printf("Err: algo %d did not end up with a single free block.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = 1;
+	int algos[4] = {FIRST_FIT, BEST_FIT, TLSF, SEG_FIT};
+
+	for (int i = 0; i < 4 && result; i++) {
+		result = batch_round(algos[i], 24) && batch_round(algos[i], 300);
+	}
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Batch alloc test passed.\r\n");
+	}
+	return result;
+}
+
+#endif
+#if TEST == 118
+/*
+ * heap checking, build the kernel with MEM_CHECK defined.
+ * the heap stays sane through a random workload, and a block whose payload ran
+ * into the next header is caught by k_mem_check() and by its own dealloc
+ */
+
+#define N 2000
+#define SLOTS 64
+#define MANUAL_UNIT_TEST_OK 1
+#define MANUAL_UNIT_TEST_FAIL 0
+
+void *g_slots[SLOTS];
+
+int check_round(int algo) {
+	unsigned int seed = 1;
+
+	k_mem_init_algo(algo);
+	for (int i = 0; i < SLOTS; i++) {
+		g_slots[i] = NULL;
+	}
+	for (int i = 0; i < N; i++) {
+		seed = seed * 1103515245 + 12345;
+		int k = (seed >> 16) % SLOTS;
+		if (g_slots[k] != NULL) {
+			k_mem_dealloc(g_slots[k]);
+			g_slots[k] = NULL;
+		} else {
+			g_slots[k] = k_mem_alloc((seed >> 8) % 600 + 1);
+		}
+		if (i % 100 == 0 && k_mem_check() != RTX_OK) {
+			printf("Err: algo %d heap broken after %d operations.\r\n", algo, i);
+			return MANUAL_UNIT_TEST_FAIL;
+		}
+	}
+	for (int i = 0; i < SLOTS; i++) {
+		k_mem_dealloc(g_slots[i]);
+	}
+
+	/* too big for a size class, so on a fresh heap the two blocks sit next to each other */
+	k_mem_init_algo(algo);
+	unsigned char *p = k_mem_alloc(256);
+	unsigned char *q = k_mem_alloc(256);
+	if (p == NULL || q <= p + 256 || q > p + 256 + 32) {
+		printf("Err: algo %d did not put the blocks next to each other.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+
+	unsigned int saved[2];
+	unsigned int *hdr = (unsigned int *)(p + 256);
+	saved[0] = hdr[0];
+	saved[1] = hdr[1];
+	hdr[0] = 0x41414141; /* 8 bytes too many */
+	hdr[1] = 0x41414141;
+	printf("Info: two errors expected next.\r\n");
+	if (k_mem_check() == RTX_OK || k_mem_dealloc(p) == RTX_OK) {
+		printf("Err: algo %d missed the overrun.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	hdr[0] = saved[0];
+	hdr[1] = saved[1];
+
+	printf("Info: one error expected next.\r\n");
+	if (k_mem_check() != RTX_OK || k_mem_dealloc(p) != RTX_OK || k_mem_dealloc(p) == RTX_OK
+			|| k_mem_dealloc(q) != RTX_OK || k_mem_check() != RTX_OK) {
+		printf("Err: algo %d went wrong after the header was put back.\r\n", algo);
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	return MANUAL_UNIT_TEST_OK;
+}
+
+int test_mem(void) {
+	int result = 1;
+	int algos[4] = {FIRST_FIT, BEST_FIT, TLSF, SEG_FIT};
+
+	if (k_mem_check() == RTX_ERR) {
+		printf("Err: heap broken, or was the kernel built without MEM_CHECK?\r\n");
+		return MANUAL_UNIT_TEST_FAIL;
+	}
+	for (int i = 0; i < 4 && result; i++) {
+		result = check_round(algos[i]);
+	}
+
+	// leave the heap the way the rest of the system expects it
+	k_mem_init();
+	if (result) {
+		printf("Heap check test passed.\r\n");
+	}
+	return result;
+}
+
 #endif
 /*
  *===========================================================================
@@ -31,6 +31,8 @@
 #include "rtx.h"
 #include "Serial.h"
 #include "printf.h"
+#include "u_mem.h"
+#include "timer.h"
 
 extern void kcd_task(void);
 
@@ -637,7 +639,7 @@ void utask1(void) {
 		msg->length = sizeof(RTX_MSG_HDR) + LengthMsg;
 		msg->type = DEFAULT;
 		char *msgStart = (char*)((U8)msg + sizeof(RTX_MSG_HDR));
-		task_t task2Tid = 158;
+		task_t task2Tid = 2; // boot tasks get the lowest free tids in order
 
 
 
@@ -682,6 +684,757 @@ void utask2(void) {
 
 #endif
 
+#if TEST == 5
+
+/* the worker allocates and exits without freeing anything, exit has to hand it all back */
+void utask2(void) {
+	for (int i = 0; i < 5; i++) {
+		mem_alloc(24 + 40 * i);
+	}
+	printf("[UT2] Info: worker %d holds 5 blocks and exits\r\n", tsk_get_tid());
+	mem_dump_task(tsk_get_tid());
+	tsk_exit();
+}
+
+void utask1(void) {
+	task_t worker;
+	int before = mem_count_extfrag(0x7FFFFFFF);
+
+	// the worker has a higher priority, so it runs and exits before tsk_create returns
+	if (tsk_create(&worker, &utask2, HIGH, 0x200) != RTX_OK) {
+		printf("[UT1] Err: could not create the worker\r\n");
+		tsk_exit();
+	}
+
+	if (mem_dump_task(worker) != 0) {
+		printf("[UT1] Err: worker blocks were not reclaimed on exit\r\n");
+	} else if (mem_count_extfrag(0x7FFFFFFF) != before) {
+		printf("[UT1] Err: reclaimed blocks did not coalesce, %d free blocks before, %d after\r\n",
+				before, mem_count_extfrag(0x7FFFFFFF));
+	} else {
+		printf("[UT1] Info: worker blocks reclaimed\r\n");
+	}
+	tsk_exit();
+}
+
+#endif
+
+
+#if TEST == 6
+
+/*
+ * per-task allocation cache: objects of a class share a chunk, an emptied cache
+ * leaves the heap the way it found it, and a task exiting with a live cache
+ * loses nothing
+ */
+
+#define OBJS 100
+
+/* exits holding cached objects and a chunk */
+void utask2(void) {
+	U_CACHE cache;
+	u_cache_init(&cache);
+	for (int i = 0; i < 20; i++) {
+		u_alloc(&cache, 8 + 6 * i);
+	}
+	tsk_exit();
+}
+
+void utask1(void) {
+	U_CACHE cache;
+	void *objs[OBJS];
+	task_t worker;
+	int before = mem_count_extfrag(0x7FFFFFFF);
+
+	u_cache_init(&cache);
+	for (int i = 0; i < OBJS; i++) {
+		objs[i] = u_alloc(&cache, 24);
+		for (int j = 0; j < 24; j++) {
+			((U8 *)objs[i])[j] = i;
+		}
+		if (i > 0 && ((U32)objs[i] & ~(U_CHUNK_SIZE - 1)) != ((U32)objs[i - 1] & ~(U_CHUNK_SIZE - 1))
+				&& (i % ((U_CHUNK_SIZE - U_CHUNK_HDR) / 32)) != 0) {
+			printf("[UT1] Err: object %d did not come from the chunk of the one before\r\n", i);
+		}
+	}
+	for (int i = 0; i < OBJS; i++) {
+		for (int j = 0; j < 24; j++) {
+			if (((U8 *)objs[i])[j] != i) {
+				printf("[UT1] Err: object %d was overwritten\r\n", i);
+				break;
+			}
+		}
+	}
+
+	void *big = u_alloc(&cache, 500);
+	if (u_free(&cache, big) != RTX_OK || u_free(&cache, (U8 *)objs[5] + 4) != RTX_ERR) {
+		printf("[UT1] Err: u_free accepted a bad pointer or refused a big block\r\n");
+	}
+	for (int i = OBJS - 1; i >= 0; i--) {
+		u_free(&cache, objs[i]);
+	}
+	u_cache_destroy(&cache);
+	if (mem_count_extfrag(0x7FFFFFFF) != before) {
+		printf("[UT1] Err: the cache did not give all its chunks back\r\n");
+	}
+
+	// the worker has a higher priority, so it runs and exits before tsk_create returns
+	if (tsk_create(&worker, &utask2, HIGH, 0x200) != RTX_OK) {
+		printf("[UT1] Err: could not create the worker\r\n");
+	} else if (mem_dump_task(worker) != 0 || mem_count_extfrag(0x7FFFFFFF) != before) {
+		printf("[UT1] Err: the worker's chunks were not reclaimed on exit\r\n");
+	} else {
+		printf("[UT1] Info: allocation cache test done\r\n");
+	}
+	tsk_exit();
+}
+
+#endif
+
+
+#if TEST == 7
+
+/*
+ * stack high-water mark: a worker goes about 600 bytes deep into a 0x400 byte stack,
+ * then drops its priority so utask1 can look at how much of it was used
+ */
+
+#define DEPTH 600
+
+int dig(int depth) {
+	volatile U8 frame[64];
+	frame[0] = depth;
+	if (depth > (int)sizeof(frame)) {
+		return dig(depth - sizeof(frame)) + frame[0];
+	}
+	return frame[0];
+}
+
+void utask2(void) {
+	dig(DEPTH);
+	tsk_set_prio(tsk_get_tid(), LOW);
+	tsk_exit();
+}
+
+void utask1(void) {
+	task_t worker;
+	RTX_TASK_INFO info;
+	U16 k_used, u_used;
+
+	// the worker has a higher priority, so it runs until it drops it before tsk_create returns
+	if (tsk_create(&worker, &utask2, HIGH, 0x400) != RTX_OK) {
+		printf("[UT1] Err: could not create the worker\r\n");
+		tsk_exit();
+	}
+	if (tsk_get_info(worker, &info) != RTX_OK || tsk_get_stack_use(worker, &k_used, &u_used) != RTX_OK) {
+		printf("[UT1] Err: no stack use for the worker\r\n");
+	} else if (info.u_stack_used != u_used || info.k_stack_used != k_used) {
+		printf("[UT1] Err: tsk_get_info and tsk_get_stack_use disagree\r\n");
+	} else if (u_used < DEPTH || u_used >= 0x400 || k_used == 0 || k_used >= K_STACK_SIZE) {
+		printf("[UT1] Err: worker used %d of its user stack and %d of its kernel stack\r\n", u_used, k_used);
+	} else {
+		printf("[UT1] Info: worker used %d bytes of user stack, %d of kernel stack\r\n", u_used, k_used);
+	}
+
+	tsk_get_stack_use(tsk_get_tid(), &k_used, &u_used);
+	printf("[UT1] Info: utask1 used %d bytes of user stack, %d of kernel stack\r\n", u_used, k_used);
+	if (tsk_get_stack_use(MAX_TASKS, &k_used, &u_used) != RTX_ERR) {
+		printf("[UT1] Err: stack use of a tid out of range\r\n");
+	}
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 8
+
+/*
+ * kernel stacks come and go with their tasks: more workers are created and exit
+ * than there are tids, and the boot task runs on the kernel stack size it asked for
+ */
+
+#define ROUNDS (2 * MAX_TASKS)
+
+int g_ran = 0;
+
+void utask2(void) {
+	g_ran++;
+	tsk_exit();
+}
+
+void utask1(void) {
+	task_t worker;
+	RTX_TASK_INFO info;
+
+	if (tsk_get_info(tsk_get_tid(), &info) != RTX_OK || info.k_stack_size != 0x400) {
+		printf("[UT1] Err: boot task did not get the kernel stack size it asked for\r\n");
+	}
+
+	int before = mem_count_extfrag(0x7FFFFFFF);
+	// each worker has a higher priority, so it runs and exits before tsk_create returns
+	for (int i = 0; i < ROUNDS; i++) {
+		if (tsk_create(&worker, &utask2, HIGH, 0x200) != RTX_OK) {
+			printf("[UT1] Err: could not create worker %d\r\n", i);
+			break;
+		}
+	}
+	if (g_ran != ROUNDS) {
+		printf("[UT1] Err: %d of %d workers ran\r\n", g_ran, ROUNDS);
+	} else if (mem_count_extfrag(0x7FFFFFFF) != before) {
+		printf("[UT1] Err: worker stacks did not all come back\r\n");
+	} else {
+		printf("[UT1] Info: %d workers came and went\r\n", ROUNDS);
+	}
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 9
+
+/*
+ * scheduler cost as the number of tasks grows: ready workers pile up behind two
+ * MEDIUM tasks, spread over the priorities below them, and at each step we time a
+ * tsk_create and a yield round trip between the two MEDIUM tasks. The ready queue
+ * is a bitmap over per priority lists, so both should stay flat.
+ * The workers only get to run once both MEDIUM tasks are gone.
+ */
+
+#define YIELDS 100
+
+int g_done = 0;
+int g_ran = 0;
+int g_workers = 0;
+
+void utask3(void) {
+	if (++g_ran == g_workers) {
+		printf("[UT3] Info: all %d workers ran\r\n", g_workers);
+	}
+	tsk_exit();
+}
+
+void utask2(void) {
+	while (!g_done) {
+		tsk_yield();
+	}
+	tsk_exit();
+}
+
+void utask1(void) {
+	static const int steps[] = {10, 100, 1000, 4000};
+	task_t worker;
+
+	for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++) {
+		unsigned int start = timer_get_current_val(2);
+		int first = g_workers;
+		while (g_workers < steps[i]) {
+			if (tsk_create(&worker, &utask3, LOW + g_workers % (PRIO_BG - LOW), 0x200) != RTX_OK) {
+				printf("[UT1] Err: could not create worker %d\r\n", g_workers);
+				break;
+			}
+			g_workers++;
+		}
+		unsigned int end = timer_get_current_val(2);
+		if (g_workers != steps[i]) {
+			break;
+		}
+		unsigned int create_us = (start - end) / (g_workers - first);
+
+		// each yield goes to utask2 and comes straight back
+		start = timer_get_current_val(2);
+		for (int j = 0; j < YIELDS; j++) {
+			tsk_yield();
+		}
+		end = timer_get_current_val(2);
+		// Clock counts down
+		printf("[UT1] Info: %d ready tasks, tsk_create %u us, yield round trip %u us\r\n",
+				g_workers, create_us, (start - end) / YIELDS);
+	}
+
+	g_done = 1;
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 10
+
+/*
+ * tsk_ls and mbx_ls list the live tids lowest first, and a tid that is given
+ * back is the next one handed out
+ */
+
+void utask2(void) {
+	tsk_exit();
+}
+
+void utask1(void) {
+	task_t buf[8];
+	task_t worker;
+	int n;
+
+	mbx_create(100);
+	for (int i = 0; i < 3; i++) {
+		tsk_create(&worker, &utask2, LOW, 0x200);
+	}
+
+	// null task, us and the three workers that have not run yet
+	n = tsk_ls(buf, 8);
+	if (n != 5 || buf[0] != TID_NULL || buf[1] != tsk_get_tid() || buf[4] != worker) {
+		printf("[UT1] Err: tsk_ls found %d tasks\r\n", n);
+	}
+	if (tsk_ls(buf, 2) != 2 || tsk_ls(NULL, 8) != RTX_ERR) {
+		printf("[UT1] Err: tsk_ls did not respect its arguments\r\n");
+	}
+	n = mbx_ls(buf, 8);
+	if (n != 1 || buf[0] != tsk_get_tid()) {
+		printf("[UT1] Err: mbx_ls found %d mailboxes\r\n", n);
+	}
+
+	// a HIGH worker runs and exits before tsk_create returns, so its tid is free again
+	task_t first, second;
+	tsk_create(&first, &utask2, HIGH, 0x200);
+	tsk_create(&second, &utask2, HIGH, 0x200);
+	if (first != worker + 1 || second != first) {
+		printf("[UT1] Err: got tid %d then %d\r\n", first, second);
+	} else {
+		printf("[UT1] Info: tid %d handed out twice\r\n", first);
+	}
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 11
+
+/*
+ * EDF: utask1 has a period of 5 ms and utask2 one of 2 ms, both released at boot.
+ * utask2 has the earlier deadline so it runs first even though it was created second,
+ * every job finishes inside its own period, and utask3 only runs while no job is ready
+ */
+
+#define JOBS1   4
+#define JOBS2   10
+
+task_t g_order[JOBS1 + JOBS2];  // tid of every job, in the order they ran
+volatile int g_jobs = 0;
+int g_late = 0;
+volatile int g_idle = 0;        // loops of the background task
+int g_idle_seen = 0;            // the background task ran between two jobs
+
+/* one job of the caller, job n of a task with period period_us has to run in [n, n + 1) periods */
+static void rt_job(U32 period_us, int n) {
+	TIMEVAL now;
+	get_time(&now);
+	U32 t = now.sec * 1000000 + now.usec;
+	if (t < n * period_us || t >= (n + 1) * period_us) {
+		g_late++;
+	}
+	g_order[g_jobs++] = tsk_get_tid();
+	g_idle_seen |= (n == 1 && g_idle != 0);
+}
+
+void utask1(void) {
+	for (int n = 0; n < JOBS1; n++) {
+		rt_job(5000, n);
+		tsk_done_rt();
+	}
+	tsk_exit();
+}
+
+void utask2(void) {
+	for (int n = 0; n < JOBS2; n++) {
+		rt_job(2000, n);
+		tsk_done_rt();
+	}
+	tsk_exit();
+}
+
+void utask3(void) {
+	TASK_RT bad;
+	task_t tid;
+	bad.p_n.sec = 0;
+	bad.p_n.usec = 150;     // not a whole number of ticks
+	bad.c_n.sec = 0;
+	bad.c_n.usec = 100;
+	bad.task_entry = &utask2;
+	bad.u_stack_size = 0x200;
+	bad.rt_mbx_size = 0;
+	if (tsk_create_rt(&tid, &bad) != RTX_ERR || tsk_set_prio(g_order[0], HIGH) != RTX_ERR) {
+		printf("[UT3] Err: real-time task calls accepted bad arguments\r\n");
+	}
+	bad.p_n.usec = 1000;
+	bad.c_n.usec = 700;     // 0.2 + 0.25 + 0.7 of the CPU
+	if (tsk_create_rt(&tid, &bad) != RTX_ERR) {
+		printf("[UT3] Err: EDF admitted a task set with a utilization over 1\r\n");
+	}
+
+	while (g_jobs < JOBS1 + JOBS2) {
+		g_idle++;
+	}
+
+	if (g_order[0] != 2 || g_order[1] != 1) {
+		printf("[UT3] Err: first jobs ran as tid %d then %d\r\n", g_order[0], g_order[1]);
+	} else if (g_late != 0) {
+		printf("[UT3] Err: %d jobs ran outside their period\r\n", g_late);
+	} else if (!g_idle_seen) {
+		printf("[UT3] Err: the background task did not run between jobs\r\n");
+	} else {
+		printf("[UT3] Info: %d jobs in deadline order, background ran %d loops\r\n", g_jobs, g_idle);
+	}
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 12
+
+/*
+ * RM_PS: utask1 is real-time with a period of 4 ms, utask2 and utask3 are not and only run
+ * on the polling server, 2 ms of budget every 10 ms. utask2 spins and notes every tick it
+ * sees, it must not see more than the budget in any server period. utask3 is above it and
+ * sleeps 5 ms at a time with tsk_suspend.
+ */
+
+#define JOBS        20
+#define QTM         100     // us per tick, see ae_set_sys_info
+#define PS_TICKS    100     // server period
+#define PS_BUDGET   20
+
+volatile int g_jobs = 0;
+int g_late = 0;
+int g_seen[JOBS * 4000 / (PS_TICKS * QTM) + 1];  // ticks utask2 ran in, per server period
+int g_short_sleep = 0;
+
+static U32 now_ticks(void) {
+	TIMEVAL now;
+	get_time(&now);
+	return (now.sec * 1000000 + now.usec) / QTM;
+}
+
+void utask1(void) {
+	for (int n = 0; n < JOBS; n++) {
+		U32 t = now_ticks() * QTM;
+		if (t < n * 4000 || t >= (n + 1) * 4000) {
+			g_late++;
+		}
+		g_jobs++;
+		tsk_done_rt();
+	}
+	tsk_exit();
+}
+
+void utask3(void) {
+	TASK_RT big;
+	task_t tid;
+	big.p_n.sec = 0;
+	big.p_n.usec = 5000;
+	big.c_n.sec = 0;
+	big.c_n.usec = 4500;    // utask1 preempts it twice, it would need 5.5 ms
+	big.task_entry = &utask1;
+	big.u_stack_size = 0x200;
+	big.rt_mbx_size = 0;
+	if (tsk_create_rt(&tid, &big) != RTX_ERR) {
+		printf("[UT3] Err: RM admitted a task that cannot meet its deadline\r\n");
+		g_late++;
+	}
+
+	TIMEVAL tv;
+	tv.sec = 0;
+	tv.usec = 5000;
+	while (g_jobs < JOBS) {
+		U32 before = now_ticks();
+		tsk_suspend(&tv);
+		if (now_ticks() - before < 5000 / QTM - 1) {
+			g_short_sleep++;
+		}
+	}
+	tsk_exit();
+}
+
+void utask2(void) {
+	U32 last = (U32) -1;
+	while (g_jobs < JOBS) {
+		U32 t = now_ticks();
+		if (t != last && t / PS_TICKS < sizeof(g_seen) / sizeof(g_seen[0])) {
+			g_seen[t / PS_TICKS]++;
+			last = t;
+		}
+	}
+
+	int worst = 0;
+	for (int i = 0; i < sizeof(g_seen) / sizeof(g_seen[0]); i++) {
+		worst = (g_seen[i] > worst) ? g_seen[i] : worst;
+	}
+	// a task that is switched in part way through a tick sees that tick too
+	if (g_late != 0) {
+		printf("[UT2] Err: %d real-time jobs ran outside their period\r\n", g_late);
+	} else if (worst == 0 || worst > PS_BUDGET + 1) {
+		printf("[UT2] Err: ran in %d ticks of one server period, budget is %d\r\n", worst, PS_BUDGET);
+	} else if (g_short_sleep != 0) {
+		printf("[UT2] Err: tsk_suspend came back early %d times\r\n", g_short_sleep);
+	} else {
+		printf("[UT2] Info: at most %d ticks per server period, %d jobs on time\r\n", worst, g_jobs);
+	}
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 13
+
+/*
+ * Admission control under RM with ticks of 1 ms. A with a period of 5 ms and a WCET of 2 ms
+ * gets in. B with 7 ms and 4 ms does not: that is only 97% of the CPU, but a job of B can be
+ * preempted twice by A and end after 8 ms. B with 3 ms fits, and once A has exited so does
+ * B with 4 ms. Every real-time task runs three jobs and exits
+ */
+
+#define RT_JOBS     3
+
+volatile int g_exited = 0;
+
+void utask2(void) {
+	for (int n = 0; n < RT_JOBS; n++) {
+		tsk_done_rt();
+	}
+	g_exited++;
+	tsk_exit();
+}
+
+static int create_rt(task_t *tid, U32 period_us, U32 wcet_us) {
+	TASK_RT task;
+	task.p_n.sec = 0;
+	task.p_n.usec = period_us;
+	task.c_n.sec = 0;
+	task.c_n.usec = wcet_us;
+	task.task_entry = &utask2;
+	task.u_stack_size = 0x200;
+	task.rt_mbx_size = 0;
+	return tsk_create_rt(tid, &task);
+}
+
+void utask1(void) {
+	task_t a;
+	task_t b;
+	RTX_TASK_INFO info;
+	int created = 0;
+
+	if (create_rt(&a, 5000, 2000) != RTX_OK) {
+		printf("[UT1] Err: A was not admitted on its own\r\n");
+		tsk_exit();
+	}
+	created++;
+	if (tsk_get_info(a, &info) != RTX_OK || info.c_n.sec != 0 || info.c_n.usec != 2000) {
+		printf("[UT1] Err: tsk_get_info does not give back the WCET of A\r\n");
+	}
+	if (create_rt(&b, 7000, 4000) != RTX_ERR) {
+		printf("[UT1] Err: B with 4 ms was admitted next to A\r\n");
+		created++;
+	}
+	if (create_rt(&b, 7000, 3000) == RTX_OK) {
+		created++;
+	} else {
+		printf("[UT1] Err: B with 3 ms was not admitted next to A\r\n");
+	}
+
+	while (tsk_get_info(a, &info) == RTX_OK) {
+		// A is done after three jobs
+	}
+	if (create_rt(&b, 7000, 4000) == RTX_OK) {
+		created++;
+	} else {
+		printf("[UT1] Err: B with 4 ms was not admitted after A exited\r\n");
+	}
+
+	while (g_exited < created) {
+	}
+	printf("[UT1] Info: %d real-time tasks admitted and done\r\n", created);
+	tsk_exit();
+}
+
+#endif
+
+#if TEST == 14
+
+/*
+ * Deadline misses under EDF. utask1 creates three real-time tasks one after the other, each
+ * with a period of 4 ms and a first job that runs for 6 ms, and it sleeps while they run.
+ * abort_task runs under MISS_ABORT | MISS_NOTIFY: its first job is dropped at 4 ms, the task
+ * starts over and utask1 gets an RT_MISS message. skip_task runs under MISS_SKIP: its second
+ * job is released at 8 ms, not 4. demote_task runs under MISS_DEMOTE: its first job ends at
+ * LOWEST priority, the second one is real-time again. leak_task allocates in every job and
+ * runs over the first LEAK_JOBS of them under MISS_ABORT: the blocks of an aborted job have to
+ * go back to the heap, not wait for the task to exit
+ */
+
+#define PERIOD_US   4000
+#define LONG_US     6000
+#define LEAK_JOBS   4
+
+int g_starts = 0;               // times abort_task started at its entry
+U32 g_second_job = 0;           // release to release time of skip_task
+U8 g_prio_late = 0;             // priority of demote_task after its deadline
+U8 g_prio_next = 0;             // and in its second job
+RTX_RT_STATS g_stats[3];
+int g_leak_starts = 0;          // times leak_task started at its entry
+int g_leak_held = 0;            // most blocks leak_task owned at the start of a job
+U8 g_policy;                    // what the next task sets up for itself
+task_t g_supervisor;
+
+static U32 now_us(void) {
+	TIMEVAL now;
+	get_time(&now);
+	return now.sec * 1000000 + now.usec;
+}
+
+static void spin(U32 us) {
+	U32 start = now_us();
+	while (now_us() - start < us) {
+	}
+}
+
+/* a real-time task preempts its creator right away, so it sets up its own policy */
+static void set_policy(void) {
+	tsk_set_miss_policy(tsk_get_tid(), g_policy, g_supervisor);
+}
+
+static void abort_task(void) {
+	set_policy();
+	if (++g_starts == 1) {
+		spin(LONG_US);
+	}
+	tsk_done_rt();
+	tsk_done_rt();
+	tsk_get_rt_stats(tsk_get_tid(), &g_stats[0]);
+	tsk_exit();
+}
+
+static void skip_task(void) {
+	set_policy();
+	U32 start = now_us();
+	spin(LONG_US);
+	tsk_done_rt();
+	g_second_job = now_us() - start;
+	tsk_done_rt();
+	tsk_get_rt_stats(tsk_get_tid(), &g_stats[1]);
+	tsk_exit();
+}
+
+static void demote_task(void) {
+	RTX_TASK_INFO info;
+	set_policy();
+	spin(LONG_US);
+	tsk_get_info(tsk_get_tid(), &info);
+	g_prio_late = info.prio;
+	tsk_done_rt();
+	tsk_get_info(tsk_get_tid(), &info);
+	g_prio_next = info.prio;
+	tsk_done_rt();
+	tsk_get_rt_stats(tsk_get_tid(), &g_stats[2]);
+	tsk_exit();
+}
+
+static void leak_task(void) {
+	set_policy();
+	int held = mem_dump_task(tsk_get_tid());
+	if (held > g_leak_held) {
+		g_leak_held = held;
+	}
+	if (++g_leak_starts <= LEAK_JOBS) {
+		mem_alloc(0x100);
+		spin(LONG_US);
+	}
+	tsk_done_rt();
+	tsk_exit();
+}
+
+/* runs entry as a real-time task under policy until it exits, RTX_ERR if it could not be created */
+static int run_rt(void (*entry)(), U8 policy, task_t *tid) {
+	TASK_RT task;
+	RTX_TASK_INFO info;
+	TIMEVAL tick;
+	task.p_n.sec = 0;
+	task.p_n.usec = PERIOD_US;
+	task.c_n.sec = 0;
+	task.c_n.usec = 1000;
+	task.task_entry = entry;
+	task.u_stack_size = 0x200;
+	task.rt_mbx_size = 0;
+	tick.sec = 0;
+	tick.usec = 1000;
+
+	g_policy = policy;
+	g_supervisor = tsk_get_tid();
+	if (tsk_create_rt(tid, &task) != RTX_OK) {
+		return RTX_ERR;
+	}
+	while (tsk_get_info(*tid, &info) == RTX_OK) {
+		// sleep so a demoted job gets the CPU
+		tsk_suspend(&tick);
+	}
+	return RTX_OK;
+}
+
+void utask1(void) {
+	task_t tid;
+	task_t sender;
+	int err = 0;
+	U8 buf[sizeof(RTX_MSG_HDR) + sizeof(RT_MISS_INFO)];
+	RTX_MSG_HDR *hdr = (RTX_MSG_HDR *) buf;
+	RT_MISS_INFO *miss = (RT_MISS_INFO *) (buf + sizeof(RTX_MSG_HDR));
+
+	mbx_create(0x100);
+
+	if (run_rt(&abort_task, MISS_ABORT | MISS_NOTIFY, &tid) != RTX_OK) {
+		printf("[UT1] Err: could not run the MISS_ABORT task\r\n");
+		err++;
+	} else if (recv_msg(&sender, buf, sizeof(buf)) != RTX_OK || hdr->type != RT_MISS
+			|| sender != tid || miss->tid != tid || miss->misses != 1) {
+		printf("[UT1] Err: no RT_MISS message for the aborted job\r\n");
+		err++;
+	} else if (g_starts != 2 || g_stats[0].misses != 1 || g_stats[0].jobs != 2) {
+		printf("[UT1] Err: MISS_ABORT started %d times, %d misses, %d jobs\r\n", g_starts, g_stats[0].misses, g_stats[0].jobs);
+		err++;
+	}
+
+	if (run_rt(&skip_task, MISS_SKIP, &tid) != RTX_OK) {
+		printf("[UT1] Err: could not run the MISS_SKIP task\r\n");
+		err++;
+	} else if (g_second_job < 2 * PERIOD_US - 100 || g_stats[1].misses != 1) {
+		printf("[UT1] Err: MISS_SKIP released after %d us with %d misses\r\n", g_second_job, g_stats[1].misses);
+		err++;
+	}
+
+	if (run_rt(&demote_task, MISS_DEMOTE, &tid) != RTX_OK) {
+		printf("[UT1] Err: could not run the MISS_DEMOTE task\r\n");
+		err++;
+	} else if (g_prio_late != LOWEST || g_prio_next != PRIO_RT
+			|| g_stats[2].misses != 1 || g_stats[2].worst_response.usec < LONG_US) {
+		printf("[UT1] Err: MISS_DEMOTE ran at %d then %d, %d misses\r\n", g_prio_late, g_prio_next, g_stats[2].misses);
+		err++;
+	}
+
+	int before = mem_count_extfrag(0x7FFFFFFF);
+	if (run_rt(&leak_task, MISS_ABORT, &tid) != RTX_OK) {
+		printf("[UT1] Err: could not run the task that allocates per job\r\n");
+		err++;
+	} else if (g_leak_starts != LEAK_JOBS + 1 || g_leak_held != 0 || mem_count_extfrag(0x7FFFFFFF) != before) {
+		printf("[UT1] Err: %d aborted jobs left up to %d blocks behind\r\n", g_leak_starts - 1, g_leak_held);
+		err++;
+	}
+
+	if (tsk_set_miss_policy(tsk_get_tid(), MISS_SKIP, TID_NULL) != RTX_ERR) {
+		printf("[UT1] Err: a task that is not real-time got a miss policy\r\n");
+		err++;
+	}
+	if (err == 0) {
+		printf("[UT1] Info: aborted, skipped and demoted a late job, aborted jobs freed their blocks\r\n");
+	}
+	tsk_exit();
+}
+
+#endif
 
 /*
  *===========================================================================
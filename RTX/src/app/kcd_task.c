@@ -65,7 +65,7 @@ void kcd_task(void)
 				    DEBUG_PRINT("command string is valid and 64B or less!");
 
                     if (!msg_length || target_tid == 0 || // No identifier or identifier never registered
-                        g_tcbs[target_tid].state == DORMANT) { // Registered task no longer alive
+                        g_tcbs[target_tid]->state == DORMANT) { // Registered task no longer alive
 						DEBUG_PRINT("ERROR: command cannot be processed.!");
 						char error[28] = "Command cannot be processed";
 						send_putty_error(error, 27);
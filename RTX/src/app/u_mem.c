@@ -0,0 +1,154 @@
+/*
+ * Per-task allocation cache.
+ *
+ * Every mem_alloc is a trap into the kernel. A task that makes a lot of small
+ * allocations (message producers) keeps a U_CACHE instead: it gets 1 KB chunks from
+ * the kernel and hands out the small objects in them without a system call.
+ * A chunk only holds objects of one size class. It is aligned to its size, so the
+ * chunk of an object is found by masking its address.
+ *
+ * Chunks are ordinary heap blocks of the task, so the kernel reclaims them when
+ * the task exits even if u_cache_destroy() was never called.
+ */
+
+#include "u_mem.h"
+
+/* smallest class that holds size bytes */
+static int u_class(size_t size) {
+	int cls = 0;
+	while ((U_CLASS_MIN << cls) < size) {
+		cls++;
+	}
+	return cls;
+}
+
+static U_CHUNK* u_chunk_new(int cls) {
+	U_CHUNK *chunk = mem_alloc_aligned(U_CHUNK_SIZE, U_CHUNK_SIZE);
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	U32 size = U_CLASS_MIN << cls;
+	U32 obj = (U32)chunk + U_CHUNK_HDR;
+	chunk->free = NULL;
+	chunk->used = 0;
+	chunk->cls = cls;
+	/* link the objects back to front, so the first one is handed out first */
+	for (U32 addr = obj + ((U_CHUNK_SIZE - U_CHUNK_HDR) / size - 1) * size; addr >= obj; addr -= size) {
+		*(void **)addr = chunk->free;
+		chunk->free = (void *)addr;
+	}
+	return chunk;
+}
+
+/* takes chunk off a list, prev is the chunk before it or NULL at the head */
+static void u_unlink(U_CHUNK **list, U_CHUNK *prev, U_CHUNK *chunk) {
+	if (prev != NULL) {
+		prev->next = chunk->next;
+	} else {
+		*list = chunk->next;
+	}
+}
+
+void u_cache_init(U_CACHE *cache) {
+	for (int i = 0; i < U_CLASSES; i++) {
+		cache->partial[i] = NULL;
+		cache->full[i] = NULL;
+	}
+}
+
+/* size bytes, 16 byte aligned. no system call unless a new chunk is needed or size is over U_CLASS_MAX */
+void *u_alloc(U_CACHE *cache, size_t size) {
+	if (size == 0) {
+		return NULL;
+	}
+	if (size > U_CLASS_MAX) {
+		return mem_alloc(size);
+	}
+
+	int cls = u_class(size);
+	U_CHUNK *chunk = cache->partial[cls];
+	if (chunk == NULL) {
+		chunk = u_chunk_new(cls);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunk->next = NULL;
+		cache->partial[cls] = chunk;
+	}
+
+	void *obj = chunk->free;
+	chunk->free = *(void **)obj;
+	chunk->used++;
+	if (chunk->free == NULL) { /* it was the first partial chunk, now it is full */
+		cache->partial[cls] = chunk->next;
+		chunk->next = cache->full[cls];
+		cache->full[cls] = chunk;
+	}
+	return obj;
+}
+
+/*
+ * gives back an object from u_alloc. A chunk that ends up empty goes back to the
+ * kernel, unless it is the only chunk of its class with room left.
+ * Returns RTX_ERR if ptr is not an object of this cache or a block of the task.
+ */
+int u_free(U_CACHE *cache, void *ptr) {
+	if (ptr == NULL) {
+		return RTX_OK;
+	}
+
+	U_CHUNK *base = (U_CHUNK *)((U32)ptr & ~(U_CHUNK_SIZE - 1));
+	U_CHUNK **list = NULL;
+	U_CHUNK *prev = NULL;
+	for (int i = 0; i < 2 * U_CLASSES && list == NULL; i++) {
+		U_CHUNK **candidate = (i < U_CLASSES) ? &cache->partial[i] : &cache->full[i - U_CLASSES];
+		prev = NULL;
+		for (U_CHUNK *chunk = *candidate; chunk != NULL; chunk = chunk->next) {
+			if (chunk == base) {
+				list = candidate;
+				break;
+			}
+			prev = chunk;
+		}
+	}
+	if (list == NULL) { /* not from a chunk, so it came straight from mem_alloc */
+		return mem_dealloc(ptr);
+	}
+
+	U_CHUNK *chunk = base;
+	U32 size = U_CLASS_MIN << chunk->cls;
+	if ((U32)ptr < (U32)chunk + U_CHUNK_HDR || ((U32)ptr - (U32)chunk - U_CHUNK_HDR) % size != 0) {
+		return RTX_ERR;
+	}
+
+	*(void **)ptr = chunk->free;
+	chunk->free = ptr;
+	chunk->used--;
+
+	if (list == &cache->full[chunk->cls]) { /* room again, move it to the partial list */
+		u_unlink(list, prev, chunk);
+		chunk->next = cache->partial[chunk->cls];
+		cache->partial[chunk->cls] = chunk;
+	} else if (chunk->used == 0 && (prev != NULL || chunk->next != NULL)) {
+		u_unlink(list, prev, chunk);
+		mem_dealloc(chunk);
+	}
+	return RTX_OK;
+}
+
+/* every chunk goes back to the kernel, objects over U_CLASS_MAX have to be freed separately */
+void u_cache_destroy(U_CACHE *cache) {
+	for (int i = 0; i < U_CLASSES; i++) {
+		while (cache->partial[i] != NULL) {
+			U_CHUNK *chunk = cache->partial[i];
+			cache->partial[i] = chunk->next;
+			mem_dealloc(chunk);
+		}
+		while (cache->full[i] != NULL) {
+			U_CHUNK *chunk = cache->full[i];
+			cache->full[i] = chunk->next;
+			mem_dealloc(chunk);
+		}
+	}
+}
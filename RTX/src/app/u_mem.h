@@ -0,0 +1,36 @@
+/* Per-task allocation cache, see u_mem.c */
+
+#ifndef U_MEM_H_
+#define U_MEM_H_
+
+#include "common.h"
+#include "rtx.h"
+
+#define U_CHUNK_SIZE    0x400   /* what we get from the kernel at a time, aligned to its size */
+#define U_CLASSES       4       /* 16, 32, 64 and 128 byte objects */
+#define U_CLASS_MIN     16
+#define U_CLASS_MAX     (U_CLASS_MIN << (U_CLASSES - 1))    /* anything bigger goes to mem_alloc */
+
+/* sits at the start of every chunk, the objects follow it */
+typedef struct u_chunk {
+	struct u_chunk *next;   /* next chunk of the same class and list */
+	void           *free;   /* free objects, linked through their first word */
+	U16             used;   /* objects handed out */
+	U16             cls;
+} U_CHUNK;
+
+/* the objects start after the header, 16 byte aligned */
+#define U_CHUNK_HDR     ((sizeof(U_CHUNK) + U_CLASS_MIN - 1) & ~(U_CLASS_MIN - 1))
+
+/* one per task, it is not shared so nothing here needs locking */
+typedef struct u_cache {
+	U_CHUNK *partial[U_CLASSES];    /* chunks with at least one free object */
+	U_CHUNK *full[U_CLASSES];
+} U_CACHE;
+
+void  u_cache_init    (U_CACHE *cache);
+void *u_alloc         (U_CACHE *cache, size_t size);
+int   u_free          (U_CACHE *cache, void *ptr);
+void  u_cache_destroy (U_CACHE *cache);
+
+#endif // ! U_MEM_H_
@@ -37,7 +37,7 @@
 ; *********************************************************************************************/
 
 RAM_BASE        EQU     0x00000000      ; Cyclone V
-SVC_Stack_Size  EQU     0x00000000      ; we do not allocate SVC stack here, take it from g_k_stacks[0]
+SVC_Stack_Size  EQU     0x00000000      ; we do not allocate SVC stack here, take it from g_k_boot_stack
 
 ;reset of exception mode stacks go to c routine to set up
 IRQ_Stack_Size  EQU     0x00000000
@@ -108,13 +108,13 @@ Reset_Handler   PROC
                 IMPORT  StackInit
                 IMPORT  SystemInit
                 IMPORT  main
-                IMPORT  g_k_stacks					; the kernel stack array symbol
-                IMPORT  g_k_stack_size              ; the kernel stack size for each task
-                LDR     R0, =g_k_stacks             ; R0 has the starting address of g_k_stacks[][] array
+                IMPORT  g_k_boot_stack				; the boot kernel stack symbol
+                IMPORT  g_k_stack_size              ; the size of the boot kernel stack
+                LDR     R0, =g_k_boot_stack         ; R0 has the starting address of g_k_boot_stack[]
                 LDR     R1, =g_k_stack_size         ; R1 has the kernel stack size
                 LDR     R1, [R1]
-                ADD     R0, R0, R1                  ; Move to the high address of the first task's stack
-                MOV     SP, R0                      ; Use the first task
+                ADD     R0, R0, R1                  ; Move to the high address of the boot stack
+                MOV     SP, R0                      ; the null task keeps it
 
                 ; Put any cores other than 0 to sleep
                 MRC     p15, 0, R0, c0, c0, 5     ; Read MPIDR
@@ -224,12 +224,28 @@ EXIT_IRQ
 
 #pragma pop
 
+/**************************************************************************//**
+ * @brief   	make the task IRQ_Handler interrupted return to pc with the user
+ *              stack at usp and its registers cleared, instead of to where it was
+ * @param       k_stack_hi  top of the kernel stack of the task
+ * @pre     	the task was in USR mode, so IRQ_Handler saved its context right below
+ *              the (8B aligned) top of the kernel stack: SPSR, LR_IRQ, LR_SVC,
+ *              R12 - R0, SP_USR, LR_USR from the top down
+ *****************************************************************************/
+void irq_frame_restart(U32 k_stack_hi, U32 pc, U32 usp)
+{
+	U32 *frame = (U32 *) (k_stack_hi & ~0x7);
+	frame[-1] = INIT_CPSR_USER;
+	frame[-2] = pc;
+	for (int i = 3; i <= 16; i++) {
+		frame[-i] = 0;                  // LR_SVC, R12 - R0
+	}
+	frame[-17] = usp;
+	frame[-18] = 0;
+}
 
 void c_IRQ_Handler(void)
 {
-	static unsigned int a9_timer_last = 0xFFFFFFFF; // the initial value of free-running timer
-	unsigned int a9_timer_curr;
-
 	char switch_flag = 0;
 	// Read the ICCIAR from the CPU Interface in the GIC
 	U32 interrupt_ID = GIC_AckPending();
@@ -261,12 +277,8 @@ void c_IRQ_Handler(void)
 	else if(interrupt_ID == HPS_TIMER0_IRQ_ID)
 	{
 		timer_clear_irq(0);
-		a9_timer_curr = timer_get_current_val(2);	//get the current value of the free running timer
-		if ((a9_timer_last - a9_timer_curr) > 500000U)
-		{
-			printf("%d ms passed!\r\n", ((a9_timer_last - a9_timer_curr)/1000U));
-			a9_timer_last = a9_timer_curr;
-		}
+		// kernel tick, a real-time job that is released may preempt the running task
+		switch_flag = k_tsk_tick();
 	}
 	else if(interrupt_ID == HPS_TIMER1_IRQ_ID)
 	{
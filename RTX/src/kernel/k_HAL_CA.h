@@ -106,6 +106,7 @@ extern void __set_SP_MODE (U32 sp, U32 mode);
 extern void __ch_MODE (U32 mode);
 extern void __atomic_on(void);
 extern void __atomic_off(void);
+extern void irq_frame_restart(U32 k_stack_hi, U32 pc, U32 usp);
 
 static __inline uint32_t __get_CPSR(void) {
     register uint32_t __regCPSR __asm("cpsr");
@@ -43,6 +43,7 @@
 
 #include "device_a9.h"
 #include "common.h"
+#include "common_ext.h"
 
 /*
  *===========================================================================
@@ -64,7 +65,6 @@
  */
 typedef struct tcb {
     U32*        	ksp;    /**> ksp of the task, TCB_KSP_OFFSET = 0        */
-    task_t				insertionOrder; /**> insertion order used to make binary min heap stable	*/
     task_t          	tid;    /**> task id                                    */
     U8          	prio;   /**> Execution priority                         */
     U8          	state;  /**> task state                                 */
@@ -74,12 +74,31 @@ typedef struct tcb {
     U16             k_stack_size;       /**> kernel stack size in bytes         */
     U16             u_stack_size;       /**> user stack size in bytes           */
     void                (*ptask)();         /**> task entry address                 */
-    task_t			indexInReadyQueue;  /**> keep track of the tcb's index in ready queue*/
+    struct tcb      *readyNext;         /**> next task in the ready list of prio        */
+    struct tcb      *readyPrev;         /**> previous task in the ready list of prio    */
     U8 *mailbox;
     size_t mbTail; // CAUTION: check max size of mailbox and change data type of this field
     size_t mbHead; // CAUTION: check max size of mailbox and change data type of this field
     size_t mbCapacity; // must use size_t cuz the max size requested when creating mailbox is size_t
     size_t mbSize;
+    U32 memHead; // address of the first heap block the task owns, see k_mem.c
+    // real-time tasks only, times are in kernel ticks of g_rtx_qtm us, see k_tsk_create_rt
+    U32 rtPeriod;               // 0 for a task that is not real-time
+    U32 rtRelease;              // release time of the current job
+    U32 rtDeadline;             // absolute deadline of the current job, rtRelease + rtPeriod
+    U32 wakeTick;               // when a SUSPENDED task goes back to READY
+    struct tcb *sleepNext;      // next task in the sleep list, by wakeTick
+    U8 sleepJob;                // waking up releases the next job, FALSE after k_tsk_suspend
+    U32 rtWcet;                 // worst-case execution time of a job, what admission control counts on
+    U32 rtResponse;             // worst-case response time of a job under RM, see rtAdmit
+    U32 rtTrial;                // rtResponse while rtAdmit tries a new task
+    struct tcb *rtNext;         // next task in the admitted set, by period
+    struct tcb *dlNext;         // next job in the deadline list, see k_tsk_tick
+    U32 rtJobs;                 // jobs done
+    U32 rtMisses;               // deadlines that passed with the job still running
+    U32 rtWorst;                // longest response time of a job, in whole ticks
+    U8 rtPolicy;                // MISS_* in common_ext.h, MISS_CONTINUE by default
+    task_t rtSupervisor;        // gets an RT_MISS message for every miss under MISS_NOTIFY
 } TCB;
 
 /*
@@ -92,8 +111,8 @@ typedef struct tcb {
 extern const U32 g_k_stack_size;    // kernel stack size
 extern const U32 g_p_stack_size;    // process stack size for sys mode tasks
 
-// task kernel stacks are statically allocated inside the OS image
-extern U32 g_k_stacks[MAX_TASKS][K_STACK_SIZE >> 2] __attribute__((aligned(8)));
+// the kernel stack we boot on, the null task keeps it. task kernel stacks come from the stack region
+extern U32 g_k_boot_stack[K_STACK_SIZE >> 2] __attribute__((aligned(8)));
 
 // process stack for tasks in SYS mode, statically allocated inside the OS image  */
 extern U32 g_p_stacks[MAX_TASKS][U_STACK_SIZE >> 2] __attribute__((aligned(8)));
@@ -104,11 +123,29 @@ extern unsigned int Image$$ZI_DATA$$ZI$$Limit; 	// Linker defined symbol
 // task related globals are defined in k_task.c
 extern TCB *gp_current_task;    // always point to the current RUNNING task
 
-// TCBs are statically allocated inside the OS image
-extern TCB g_tcbs[MAX_TASKS];
+// TCBs are allocated when a task is created, tids without a task map to g_tcb_dormant
+extern TCB *g_tcbs[MAX_TASKS];
+extern TCB g_tcb_dormant;
 extern RTX_TASK_INFO g_null_task_info;
 extern U32 g_num_active_tasks;	// number of non-dormant tasks */
 
+// scheduler and kernel time, set up by k_rtx_init_rt
+extern U8 g_sched;              // DEFAULT, EDF, RM_PS or RM_NPS
+extern U32 g_rtx_qtm;           // length of a kernel tick in microseconds
+extern volatile U32 g_rtx_ticks;    // kernel ticks since boot
+extern POLLING_SERVER g_ps_server; // RM_PS polling server as configured, zero otherwise
+
+/*
+ *==========================================================================
+ *                   HELPERS
+ *==========================================================================
+ */
+
+/* index of the least significant set bit, x must not be 0 */
+static inline U32 low_bit(U32 x) {
+	return 31 - __clz(x & (~x + 1));
+}
+
 #endif // ! K_INC_H_
 
 /*
@@ -43,20 +43,98 @@
  */
 #include "k_mem.h"
 #include "Serial.h"
+#include "timer.h"
+#include "printf.h"
 #ifdef DEBUG_0
 #include "assert.h"
-#include "printf.h"
 #endif  /* DEBUG_0 */
 
 
 
-typedef struct _buffer { /* struct size: 8 */
-	struct _buffer* next; /* next free chunk */
-	U32 size;
-	task_t tid;
-	U32 filler; //this is for 8 byte alignment
+/*
+ * Every heap block, for every algorithm, starts with a 16 byte header, 8 bytes with MEM_SMALL_HEADER
+ *
+ *      allocated   +------+------+-------------+--------------------------+
+ *                  | size | info | owner links |         payload          |
+ *                  +------+------+-------------+--------------------------+
+ *
+ *      free        +------+------+------+------+---------------------+------+
+ *                  | size | info | next | prev |                     | head |
+ *                  +------+------+------+------+---------------------+------+
+ *
+ * size is the payload size with BUF_FREE and BUF_PREV_FREE in the low bits,
+ * info holds the owner tid and a check tag (see BUF_TAG) that dealloc uses to
+ * tell a real block from a stray pointer.
+ *
+ * Only free blocks have a footer: the last word of the payload points back at the
+ * header, and BUF_PREV_FREE in the next header says it is there. That is all
+ * coalescing needs to find the physically previous block in O(1).
+ *
+ * next and prev link a free block into its free list. By default (MEM_OWNER_LIST) they
+ * are part of the header and link an allocated block into its owner's list as well
+ * (16 bytes per allocated block). MEM_SMALL_HEADER drops the owner lists: they live
+ * in the payload and an allocated block costs only size and info, 8 bytes.
+ */
+typedef struct _buffer {
+	U32 size; /* payload size in bytes, the low bits hold BUF_FREE and BUF_PREV_FREE */
+	U32 info; /* owner tid in the low 16 bits, BUF_TAG in the high 16 */
+	U32 next; /* address of the next free (or next owned) block, 0 at the end of a list */
+	U32 prev; /* address of the previous free (or owned) block, 0 at the head of a list */
 } Buffer;
 
+#define BUF_FREE            0x1
+#define BUF_PREV_FREE       0x2     /* the block physically before this one is free, its footer is valid */
+#define BUF_CACHED          0x4     /* allocated block parked on a SEG_FIT size class list */
+#define BUF_FLAGS           0x7
+#ifdef MEM_OWNER_LIST
+#define BUF_HDR_SIZE        16
+#define BUF_MIN_SIZE        8       /* smallest payload worth splitting off, must hold the footer */
+#else
+#define BUF_HDR_SIZE        8
+#define BUF_MIN_SIZE        16      /* smallest payload, must hold next, prev and the footer once free */
+#endif /* MEM_OWNER_LIST */
+#define BUF_SIZE(b)         ((b)->size & ~BUF_FLAGS)
+#define BUF_TID(b)          ((task_t)((b)->info & 0xFFFF))
+#define BUF_TAG(b)          ((((U32)(b) >> 3) ^ (BUF_SIZE(b) >> 3) ^ 0xA5C3) & 0xFFFF)
+#define BUF_FOOTER(b)       ((U32*)((U32)(b) + BUF_HDR_SIZE + BUF_SIZE(b) - 4))
+#define BUF_NEXT_PHYS(b)    ((Buffer*)((U32)(b) + BUF_HDR_SIZE + BUF_SIZE(b)))
+
+/*
+ * A pool is one kernel owned heap block holding num_blks blocks of blk_size
+ * bytes followed by a bitmap of the blocks that are handed out.
+ * Free blocks keep the address of the next free block in their first word,
+ * so alloc and dealloc just pop and push that list, no search and no per block header.
+ * The bitmap is only there to catch double frees and pointers that were never handed out.
+ */
+typedef struct _pool {
+	U32 base;     /* first block, 0 if the pool slot is unused */
+	U32 end;      /* one past the last block */
+	U32 blk_size;
+	U32 num_free;
+	U32 free_head; /* address of the first free block, 0 if the pool is empty */
+	U32 *used_map; /* bit i set while block i is allocated */
+	task_t owner; /* task that created the pool, only it may delete the pool */
+} Pool;
+
+/*
+ * A slab is one kernel owned heap block cut into objects of a single size.
+ * Free objects keep the address of the next free object in their first word.
+ */
+typedef struct _slab { /* struct size: 16 */
+	U32 next; /* next slab of the same cache, 0 at the end */
+	U32 free_head; /* first free object of this slab, 0 if it is full */
+	U16 num_used;
+	U16 num_objs;
+	U32 filler; //this is for 8 byte alignment of the objects that follow
+} Slab;
+
+typedef struct _slab_cache {
+	U32 obj_size; /* 0 if the cache slot is unused */
+	U32 slabs; /* address of the first slab */
+	U32 objs_per_slab;
+} SlabCache;
+
+#define SLAB_OBJS(slab)     ((U32)(slab) + sizeof(Slab))
 
 /*
  *==========================================================================
@@ -68,9 +146,9 @@ const U32 g_k_stack_size = K_STACK_SIZE;
 // task proc space stack size in bytes, referred by system_a9.cs
 const U32 g_p_stack_size = U_STACK_SIZE;
 
-// task kernel stacks
+// the kernel stack we boot on, the null task keeps it. see startup_a9.s
 // K_STACK_SIZE >> 2 because K_STACK_SIZE is in bytes, 32/4 = 8. shift right by 2 is divide by 4
-U32 g_k_stacks[MAX_TASKS][K_STACK_SIZE >> 2] __attribute__((aligned(8)));
+U32 g_k_boot_stack[K_STACK_SIZE >> 2] __attribute__((aligned(8)));
 
 //process stack for tasks in SYS mode
 //U32 g_p_stacks[MAX_TASKS][U_STACK_SIZE >> 2] __attribute__((aligned(8)));
@@ -81,16 +159,43 @@ U32 g_k_stacks[MAX_TASKS][K_STACK_SIZE >> 2] __attribute__((aligned(8)));
  *===========================================================================
  */
 
-U32* k_alloc_k_stack(task_t tid)
+// a task kernel stack of size bytes from the stack region, NULL if there is no room.
+// the stack grows down, so this returns the high end of the block
+U32* k_alloc_k_stack(size_t size)
+{
+	U32 *lo = k_slab_alloc(size);
+	return (lo != NULL) ? lo + (PAD(size) >> 2) : NULL;
+}
+
+// hi is what k_alloc_k_stack returned
+int k_dealloc_k_stack(U32 *hi, size_t size)
+{
+	return k_slab_dealloc(hi - (PAD(size) >> 2), size);
+}
+
+// fill a new stack with STACK_PAINT, size in bytes
+void k_stack_paint(U32 *lo, U32 size)
+{
+	for (U32 i = 0; i < (size >> 2); i++) {
+		lo[i] = STACK_PAINT;
+	}
+}
+
+// bytes from the high end of a painted stack down to the deepest word that was ever written
+U32 k_stack_used(U32 *lo, U32 size)
 {
-    return g_k_stacks[tid];
+	U32 i = 0;
+	while (i < (size >> 2) && lo[i] == STACK_PAINT) {
+		i++;
+	}
+	return size - (i << 2);
 }
 
-U32* k_alloc_p_stack(U16 stack_size)
+U32* k_alloc_p_stack(size_t stack_size)
 {
 	task_t curTaskTid = gp_current_task->tid;
 	gp_current_task->tid = 0;
-    void* startOfAvailableMemory = k_mem_alloc((size_t) stack_size);
+    void* startOfAvailableMemory = k_mem_alloc(stack_size);
     gp_current_task->tid = curTaskTid;
     return startOfAvailableMemory;
 }
@@ -106,197 +211,2196 @@ int k_dealloc_p_stack(void *ptr)
 
 /*
  *===========================================================================
- *                 MARK THREE: 8 byte struct, ~1900 us N=100 Test 2
+ *                 MARK FOUR: boundary tags, O(1) coalesce and pointer checks
  *===========================================================================
  */
 
-Buffer* head = NULL;
-Buffer* first_buf = NULL;
+Buffer* head = NULL; /* first fit free list, address ordered */
+U32 g_heap_start = 0; /* first block */
+U32 g_heap_end = 0; /* one past the last block, the stack region starts here */
+U32 g_buddy_end = 0; /* one past the stack region */
+U32 g_mem_no_tcb = 0; /* blocks owned by tids that have no TCB */
+
+int g_mem_algo = MEM_ALGO_DEFAULT;
+U32 g_size_class_heads[SIZE_CLASSES]; /* cached blocks of each class, linked through next */
+U32 g_size_class_count[SIZE_CLASSES];
+Pool g_pools[MAX_POOLS];
+SlabCache g_slab_caches[SLAB_CACHES];
+
+void buddy_init(U32 base, U32 orders);
+void* buddy_alloc(U32 size);
+int buddy_free(void *ptr);
+void tlsf_init(void);
+void tlsf_insert(Buffer *block);
+void tlsf_remove(Buffer *block);
+Buffer* tlsf_find(U32 size);
+int tlsf_count_extfrag(size_t size);
+void bt_init(void);
+void bt_insert(Buffer *block);
+void bt_remove(Buffer *block);
+Buffer* bt_find(U32 size);
+int bt_count_extfrag(size_t size);
+
+/* TLSF and best fit index free blocks by size, first fit keeps them in one address ordered list */
+#define ALGO_BY_SIZE(algo)  ((algo) == TLSF || (algo) == BEST_FIT)
+
+/* mark block free with size payload bytes, writes its footer and tells the next block */
+static void buf_set_free(Buffer *block, U32 size) {
+	block->size = size | BUF_FREE; /* coalescing never leaves a free block behind a free block */
+	*BUF_FOOTER(block) = (U32)block;
+
+	Buffer *next = BUF_NEXT_PHYS(block);
+	if ((U32)next < g_heap_end) {
+		next->size |= BUF_PREV_FREE;
+	}
+}
+
+/* mark block allocated to tid with size payload bytes */
+static void buf_set_used(Buffer *block, U32 size, task_t tid) {
+	block->size = size | (block->size & BUF_PREV_FREE);
+	block->info = tid | (BUF_TAG(block) << 16);
+
+	Buffer *next = BUF_NEXT_PHYS(block);
+	if ((U32)next < g_heap_end) {
+		next->size &= ~BUF_PREV_FREE;
+	}
+}
+
+/* the block physically before block if it is free, NULL otherwise */
+static Buffer* buf_prev_free(Buffer *block) {
+	if (!(block->size & BUF_PREV_FREE)) {
+		return NULL;
+	}
+	return (Buffer*)*((U32*)block - 1);
+}
+
+/* the block physically after block if it is free, NULL otherwise */
+static Buffer* buf_next_free(Buffer *block) {
+	Buffer *next = BUF_NEXT_PHYS(block);
+	if ((U32)next >= g_heap_end) {
+		return NULL;
+	}
+	return (next->size & BUF_FREE) ? next : NULL;
+}
+
+/*
+ * header of the allocated block ptr points to, NULL if ptr is not one.
+ * only looks at the header of the block, never walks the heap
+ */
+static Buffer* buf_from_ptr(void *ptr) {
+	U32 addr = (U32)ptr;
+	if (addr < g_heap_start + BUF_HDR_SIZE || addr >= g_heap_end || (addr & 7) != 0) {
+		return NULL;
+	}
+
+	Buffer *block = (Buffer*)(addr - BUF_HDR_SIZE);
+	if (block->size & (BUF_FREE | BUF_CACHED)) { /* already free */
+		return NULL;
+	}
+	if ((block->info >> 16) != BUF_TAG(block) || BUF_SIZE(block) > g_heap_end - addr) {
+		return NULL;
+	}
+	return block;
+}
+
+/* first fit free list helpers */
+static void ff_unlink(Buffer *block) {
+	if (block->prev != 0) {
+		((Buffer*)block->prev)->next = block->next;
+	} else { /* at head */
+		head = (Buffer*)block->next;
+	}
+	if (block->next != 0) {
+		((Buffer*)block->next)->prev = block->prev;
+	}
+}
+
+/* put block where old was in the list */
+static void ff_replace(Buffer *old, Buffer *block) {
+	block->next = old->next;
+	block->prev = old->prev;
+	if (block->prev != 0) {
+		((Buffer*)block->prev)->next = (U32)block;
+	} else { /* at head */
+		head = block;
+	}
+	if (block->next != 0) {
+		((Buffer*)block->next)->prev = (U32)block;
+	}
+}
+
+/*
+ * insert a block that has no free neighbours, keeping the list address ordered.
+ * from is a free block known to lie below block to start looking at, NULL for the head
+ */
+static void ff_insert(Buffer *block, Buffer *from) {
+	Buffer *prev = (from != NULL) ? (Buffer*)from->prev : NULL;
+	Buffer *curr = (from != NULL) ? from : head;
+	while (curr != NULL && (U32)curr < (U32)block) {
+		prev = curr;
+		curr = (Buffer*)curr->next;
+	}
+
+	block->prev = (U32)prev;
+	block->next = (U32)curr;
+	if (prev != NULL) {
+		prev->next = (U32)block;
+	} else {
+		head = block;
+	}
+	if (curr != NULL) {
+		curr->prev = (U32)block;
+	}
+}
+
+#ifdef MEM_OWNER_LIST
+/*
+ * every allocated block sits on its owner's list, so a task's blocks can be found
+ * (and reclaimed when it exits) without walking the heap.
+ * tids without a TCB, like TID_UART_IRQ, share g_mem_no_tcb
+ */
+static U32* owner_head(task_t tid) {
+	return (tid < MAX_TASKS && g_tcbs[tid] != NULL && g_tcbs[tid] != &g_tcb_dormant) ? &g_tcbs[tid]->memHead : &g_mem_no_tcb;
+}
+
+static void owner_link(Buffer *block) {
+	U32 *owned = owner_head(BUF_TID(block));
+	block->prev = 0;
+	block->next = *owned;
+	if (*owned != 0) {
+		((Buffer*)*owned)->prev = (U32)block;
+	}
+	*owned = (U32)block;
+}
+
+static void owner_unlink(Buffer *block) {
+	if (block->prev != 0) {
+		((Buffer*)block->prev)->next = block->next;
+	} else {
+		*owner_head(BUF_TID(block)) = block->next;
+	}
+	if (block->next != 0) {
+		((Buffer*)block->next)->prev = block->prev;
+	}
+}
+#else
+/* without owner lists the owner is only recorded in the header, see k_mem_reclaim() */
+#define owner_link(block)
+#define owner_unlink(block)
+#endif /* MEM_OWNER_LIST */
+
+static void sized_insert(Buffer *block) {
+	if (g_mem_algo == TLSF) {
+		tlsf_insert(block);
+	} else {
+		bt_insert(block);
+	}
+}
+
+static void sized_remove(Buffer *block) {
+	if (g_mem_algo == TLSF) {
+		tlsf_remove(block);
+	} else {
+		bt_remove(block);
+	}
+}
+
+/*
+ * The boundary tags make this O(1) apart from one case:
+ *
+ * We look at the footer right before the block and the header right after it.
+ * A free previous block absorbs this one, and this one absorbs a free next block.
+ *
+ * For first fit the merged block keeps the list position of the neighbour it merged with,
+ * only a block with no free neighbours has to walk the free list to find its spot,
+ * starting at from when the caller knows a free block below target (NULL otherwise).
+ * TLSF and best fit just move the merged block to where its new size belongs.
+ * Returns the merged free block.
+ */
+static Buffer* buf_free(Buffer *target, Buffer *from) {
+	Buffer* prev = buf_prev_free(target);
+	Buffer* next = buf_next_free(target);
+	U32 size = BUF_SIZE(target);
+	target->size |= BUF_FREE; /* stale headers inside a merged block must not pass buf_from_ptr again */
+
+	if (ALGO_BY_SIZE(g_mem_algo)) {
+		if (prev != NULL) {
+			sized_remove(prev);
+			size += BUF_SIZE(prev) + BUF_HDR_SIZE;
+			target = prev;
+		}
+		if (next != NULL) {
+			sized_remove(next);
+			size += BUF_SIZE(next) + BUF_HDR_SIZE;
+		}
+		buf_set_free(target, size);
+		sized_insert(target);
+		return target;
+	}
+
+	if (prev != NULL && next != NULL) { /* prev swallows target and next, next leaves the list */
+		ff_unlink(next);
+		buf_set_free(prev, BUF_SIZE(prev) + size + BUF_SIZE(next) + 2 * BUF_HDR_SIZE);
+		return prev;
+	} else if (prev != NULL) {
+		buf_set_free(prev, BUF_SIZE(prev) + size + BUF_HDR_SIZE);
+		return prev;
+	} else if (next != NULL) { /* target swallows next and takes its place in the list */
+		ff_replace(next, target);
+		buf_set_free(target, size + BUF_SIZE(next) + BUF_HDR_SIZE);
+	} else {
+		buf_set_free(target, size);
+		ff_insert(target, from);
+	}
+	return target;
+}
+
+#ifdef MEM_STATS
+/*
+ * allocator statistics, only built with MEM_STATS defined.
+ * latencies come from the A9 private timer (1 tick = 1 us), bucket i of a histogram
+ * counts calls that took [2^(i-1), 2^i) us, bucket 0 the ones under 1 us
+ */
+RTX_MEM_STATS g_mem_stats;
+
+static U32 mem_stats_bucket(U32 us) {
+	U32 bucket = 32 - __clz(us);
+	return (bucket < MEM_STATS_BUCKETS) ? bucket : MEM_STATS_BUCKETS - 1;
+}
+
+static void mem_stats_alloc(void *ptr, U32 us) {
+	if (ptr == NULL) {
+		g_mem_stats.alloc_fail_count++;
+		return;
+	}
+	g_mem_stats.alloc_count++;
+	g_mem_stats.bytes_in_use += BUF_SIZE((Buffer*)((U32)ptr - BUF_HDR_SIZE));
+	if (g_mem_stats.bytes_in_use > g_mem_stats.bytes_hwm) {
+		g_mem_stats.bytes_hwm = g_mem_stats.bytes_in_use;
+	}
+	g_mem_stats.alloc_hist[mem_stats_bucket(us)]++;
+}
+
+static void mem_stats_dealloc(U32 size, U32 us) {
+	g_mem_stats.dealloc_count++;
+	g_mem_stats.bytes_in_use -= size;
+	g_mem_stats.dealloc_hist[mem_stats_bucket(us)]++;
+}
+#endif /* MEM_STATS */
+
+#ifdef MEM_TRACE
+/*
+ * allocation trace, only built with MEM_TRACE defined.
+ * the ring keeps the last MEM_TRACE_LEN heap operations, k_mem_trace_dump() prints them
+ * over UART for tools/mem_replay to replay on a PC
+ */
+MEM_TRACE_REC g_mem_trace[MEM_TRACE_LEN];
+U32 g_mem_trace_count = 0; /* records written since the last dump, the ring holds the newest MEM_TRACE_LEN */
+
+static void mem_trace_add(U8 op, task_t tid, U32 size, void *ptr, U32 time) {
+	MEM_TRACE_REC *rec = &g_mem_trace[g_mem_trace_count % MEM_TRACE_LEN];
+	rec->op = op;
+	rec->tid = tid;
+	rec->size = size;
+	rec->ptr = (U32)ptr;
+	rec->time = time;
+	g_mem_trace_count++;
+}
+#endif /* MEM_TRACE */
+
+#ifdef MEM_CHECK
+/*
+ * heap checking, only built with MEM_CHECK defined.
+ * BUF_TAG doubles as the canary of an allocated block and a free block must have its
+ * footer. A dealloc looks at the block and its physical neighbours before it touches any
+ * links, so a task that wrote past the end of its block is caught by the free that would
+ * have spread the damage. k_mem_check() does the same for the whole heap.
+ */
+
+/* NULL if the header of block looks sane, what is wrong with it otherwise */
+static const char* buf_check(Buffer *block) {
+	U32 addr = (U32)block;
+	if (addr < g_heap_start || addr > g_heap_end - BUF_HDR_SIZE || (addr & 7) != 0) {
+		return "is outside the heap";
+	}
+	if (BUF_SIZE(block) > g_heap_end - addr - BUF_HDR_SIZE) {
+		return "runs past the end of the heap";
+	}
+	if (block->size & BUF_FREE) {
+		if (block->size & BUF_CACHED) {
+			return "is free and cached at once";
+		}
+		if (*BUF_FOOTER(block) != addr) {
+			return "has a broken footer";
+		}
+	} else if ((block->info >> 16) != BUF_TAG(block)) {
+		return "has a broken check tag";
+	}
+	return NULL;
+}
+
+static void buf_check_report(U32 addr, const char *why) {
+	printf("k_mem: block 0x%x %s, task %d\r\n", addr, why, gp_current_task->tid);
+}
+
+/*
+ * RTX_OK if block (what buf_from_ptr() made of ptr) can be freed without spreading
+ * any damage. Says why not over UART otherwise.
+ */
+static int buf_check_free(void *ptr, Buffer *block) {
+	const char *why = NULL;
+	U32 addr = (U32)ptr - BUF_HDR_SIZE;
+
+	if (block == NULL) {
+		if ((U32)ptr >= g_heap_start + BUF_HDR_SIZE && (U32)ptr < g_heap_end && ((U32)ptr & 7) == 0
+				&& (((Buffer*)addr)->size & (BUF_FREE | BUF_CACHED))) {
+			why = "was freed twice";
+		} else {
+			why = "is not a heap block";
+		}
+	} else if ((U32)BUF_NEXT_PHYS(block) < g_heap_end && (why = buf_check(BUF_NEXT_PHYS(block))) != NULL) {
+		addr = (U32)BUF_NEXT_PHYS(block);
+	} else if (block->size & BUF_PREV_FREE) {
+		addr = *((U32*)block - 1);
+		why = buf_check((Buffer*)addr);
+		if (why == NULL && (!(((Buffer*)addr)->size & BUF_FREE) || BUF_NEXT_PHYS((Buffer*)addr) != block)) {
+			why = "is not the free block in front of its neighbour";
+		}
+	}
+
+	if (why != NULL) {
+		buf_check_report(addr, why);
+		return RTX_ERR;
+	}
+	return RTX_OK;
+}
+#else
+#define buf_check_free(ptr, block)  RTX_OK
+#endif /* MEM_CHECK */
 
 int k_mem_init(void) {
+	return k_mem_init_algo(MEM_ALGO_DEFAULT);
+}
+
+/*
+ * (re)initialize the heap managed by the given algorithm.
+ * every block handed out before the call is lost, so only call this before tasks allocate anything.
+ */
+int k_mem_init_algo(int algo) {
     unsigned int img_end_addr = (unsigned int) &Image$$ZI_DATA$$ZI$$Limit;
     if (img_end_addr >= RAM_END + 1) { /* no memory space */
     	return RTX_ERR;
     }
 
-    first_buf = (Buffer*)img_end_addr;
-    head = (Buffer*)img_end_addr;
-    head->next = NULL;
-    head->size = RAM_END-img_end_addr - sizeof(Buffer);
-    /* size used to be +1
-     * ex. if end_index: 20, start_index: 3, size: 18 - sizeof(initial_buffer) = 6
-     * but we don't anymore because it didn't work? overhead + 1 in worst case so its fine.*/
+    if (algo != FIRST_FIT && algo != BEST_FIT && algo != TLSF && algo != SEG_FIT) { /* WORST_FIT is not implemented, FIXED_POOL lives on top of the heap, see k_mem_pool_create() */
+    	return RTX_ERR;
+    }
+
+    g_heap_start = PAD(img_end_addr);
+    g_heap_end = (RAM_END + 1) & ~7;
+    if (g_heap_end <= g_heap_start + BUF_HDR_SIZE + BUF_MIN_SIZE) {
+    	return RTX_ERR;
+    }
+
+    /* the top of the heap becomes the stack region, at most half of it */
+    U32 orders = BUDDY_ORDERS;
+    while (orders > 0 && (1 << (BUDDY_MIN_LOG2 + orders - 1)) > (g_heap_end - g_heap_start) / 2) {
+    	orders--;
+    }
+    if (orders > 0) {
+    	g_heap_end -= 1 << (BUDDY_MIN_LOG2 + orders - 1);
+    }
+    buddy_init(g_heap_end, orders);
+
+    /* the whole heap starts out as one free block */
+    Buffer *first = (Buffer*)g_heap_start;
+    first->size = 0;
+    buf_set_free(first, g_heap_end - g_heap_start - BUF_HDR_SIZE);
+    first->info = 0;
+    first->next = 0;
+    first->prev = 0;
+
+    /* every pool and slab lived on the old heap */
+    for (int i = 0; i < MAX_POOLS; i++) {
+    	g_pools[i].base = 0;
+    	g_pools[i].free_head = 0;
+    }
+    for (int i = 0; i < SLAB_CACHES; i++) {
+    	g_slab_caches[i].obj_size = 0;
+    	g_slab_caches[i].slabs = 0;
+    }
+    for (int i = 0; i < SIZE_CLASSES; i++) {
+    	g_size_class_heads[i] = 0;
+    	g_size_class_count[i] = 0;
+    }
+    for (int i = 0; i < MAX_TASKS; i++) {
+    	if (g_tcbs[i] != NULL) { /* NULL until k_tsk_init */
+    		g_tcbs[i]->memHead = 0;
+    	}
+    }
+    g_mem_no_tcb = 0;
+
+#ifdef MEM_STATS
+    U32 *stats = (U32*)&g_mem_stats;
+    for (U32 i = 0; i < sizeof(RTX_MEM_STATS) / sizeof(U32); i++) {
+    	stats[i] = 0;
+    }
+#endif /* MEM_STATS */
+
+#ifdef MEM_TRACE
+    mem_trace_add(MEM_TRACE_INIT, 0, algo, NULL, timer_get_current_val(2));
+#endif /* MEM_TRACE */
+
+    g_mem_algo = algo;
+    if (algo == TLSF) {
+    	head = NULL;
+    	tlsf_init();
+    	tlsf_insert(first);
+    } else if (algo == BEST_FIT) {
+    	head = NULL;
+    	bt_init();
+    	bt_insert(first);
+    } else {
+    	head = first;
+    }
 
     return RTX_OK;
 }
 
-inline void* k_mem_alloc(size_t size) {
-	/*
-	 *
-	 * The logic is simple:
-	 * After a few sanity checks, we iterate through our linked list
-	 * of free chunks until we find one of the same size or larger.
-	 *
-	 * IF IT IS LARGER, we need to split the current chunk into an occupied chunk (current)
-	 * and free chunk (new).
-	 *
-	 * Then, if the chunk we were considering was the head, set head the new chunk.
-	 * Otherwise, make the previous point to the new chunk.
-	 *
-	 * IF IT IS THE SAME, then we just remove this chunk from the linked list. If it is the head,
-	 * set head to next. Otherwise, make previous point to next.
-	 *
-	 */
+/*
+ * SEG_FIT puts a size class list in front of first fit for blocks up to SIZE_CLASS_MAX.
+ * Freed small blocks are parked on their class list still marked allocated (BUF_CACHED)
+ * instead of coalescing, and handed out again in O(1). A class that runs dry carves
+ * SIZE_CLASS_BATCH neighbouring blocks out of the heap with one first fit search,
+ * which also keeps small objects of one size packed together.
+ * Parked blocks do not show up as free space, so it is opt-in through k_mem_init_algo(SEG_FIT).
+ */
+static void* buf_alloc_fit(U32 size);
 
-    /* return NULL if given size is 0 or mem_init has not been run*/
-	if ((size == 0) || (head == NULL)) {
-		return NULL;
+/* class of a padded size, rounding up */
+static int size_class(U32 size) {
+	return (size <= 8) ? 0 : 29 - __clz(size - 1);
+}
+
+/* put an allocated block on its class list, 0 if the class holds enough already */
+static int size_class_push(Buffer *block) {
+	if (BUF_SIZE(block) > SIZE_CLASS_MAX) {
+		return 0;
+	}
+	int cls = 28 - __clz(BUF_SIZE(block)); /* round down, a leftover block can be bigger than its class */
+	if (g_size_class_count[cls] >= SIZE_CLASS_KEEP) {
+		return 0;
 	}
 
+	block->size |= BUF_CACHED;
+	block->next = g_size_class_heads[cls];
+	g_size_class_heads[cls] = (U32)block;
+	g_size_class_count[cls]++;
+	return 1;
+}
 
-	size = PAD(size); /* bit magic goes fast with malloc inline. dont inline dealloc */
+/* give every cached block back to the heap, returns how many there were */
+static int size_class_flush(void) {
+	int count = 0;
+	for (int cls = 0; cls < SIZE_CLASSES; cls++) {
+		while (g_size_class_heads[cls] != 0) {
+			Buffer *block = (Buffer*)g_size_class_heads[cls];
+			g_size_class_heads[cls] = block->next;
+			block->size &= ~BUF_CACHED;
+			buf_free(block, NULL);
+			count++;
+		}
+		g_size_class_count[cls] = 0;
+	}
+	return count;
+}
 
-	Buffer* curr = head;
-	Buffer* prev = NULL;
+/* carve up to SIZE_CLASS_BATCH blocks of class cls out of the heap, the first one is returned */
+static Buffer* size_class_refill(int cls) {
+	U32 size = 8 << cls;
+	if (size < BUF_MIN_SIZE) {
+		size = BUF_MIN_SIZE;
+	}
+	U32 stride = size + BUF_HDR_SIZE;
 
-	/* loop through free structs */
-	while (curr != NULL) {
-		if (curr->size >= size) {
-
-			if (curr->size > (size + sizeof(Buffer))) { /* enough room to break into 2 chunks, create new Buffer at end of region*/
-				Buffer* new_buffer = (Buffer*)((U32)curr + size + sizeof(Buffer));
-				new_buffer->next = curr->next;
-				new_buffer->size = curr->size - size - sizeof(Buffer);
-				if (prev == NULL) { /* at head */
-					head = new_buffer;
-				} else {
-					prev->next = new_buffer;
-				}
+	/* the heap may be too full for a whole batch, settle for fewer */
+	void *ptr = NULL;
+	int n;
+	for (n = SIZE_CLASS_BATCH; n > 0 && ptr == NULL; n /= 2) {
+		ptr = buf_alloc_fit(n * stride - BUF_HDR_SIZE);
+	}
+	if (ptr == NULL) {
+		return NULL;
+	}
 
-				/* no need to set next_ptr of a allocated block to anything*/
-				curr->size = size;
-			} else { /* if exact size, remove curr from the linked list */
-				if (prev == NULL) { /* at head */
-					head = curr->next;
-				} else {
-					prev->next = curr->next;
-				}
+	Buffer *run = (Buffer*)((U32)ptr - BUF_HDR_SIZE);
+	owner_unlink(run);
+
+	/*
+	 * split the run into blocks, the last one keeps whatever buf_alloc_fit() did not split off.
+	 * the class is empty, so the blocks are appended to hand them out in address order
+	 */
+	U32 end = (U32)BUF_NEXT_PHYS(run);
+	U32 *tail = &g_size_class_heads[cls];
+	Buffer *block = run;
+	while (1) {
+		U32 left = end - (U32)block - BUF_HDR_SIZE;
+		U32 block_size = (left >= stride + BUF_MIN_SIZE) ? size : left;
+		if (block != run) {
+			block->size = 0;
+			buf_set_used(block, block_size, 0);
+			if (block_size == size) {
+				block->size |= BUF_CACHED;
+				block->next = 0;
+				*tail = (U32)block;
+				tail = &block->next;
+				g_size_class_count[cls]++;
+			} else if (!size_class_push(block)) { /* a leftover too big for any class */
+				buf_free(block, NULL);
+				break;
 			}
-			curr->tid = gp_current_task->tid;
-			return (void*)((U32)curr + sizeof(Buffer)); /* pointer to allocated memory */
+		} else {
+			buf_set_used(block, block_size, BUF_TID(run));
+		}
+		if (block_size == left) {
+			break;
 		}
+		block = BUF_NEXT_PHYS(block);
+	}
+	return run;
+}
 
-		prev = curr;
-		curr = curr->next;
+/* O(1) unless the class has to be refilled */
+static void* size_class_alloc(U32 size) {
+	int cls = size_class(size);
+	Buffer *block = (Buffer*)g_size_class_heads[cls];
+
+	if (block != NULL) {
+		g_size_class_heads[cls] = block->next;
+		g_size_class_count[cls]--;
+		block->size &= ~BUF_CACHED;
+	} else {
+		block = size_class_refill(cls);
+		if (block == NULL) {
+			return NULL;
+		}
 	}
-    return NULL;	/* failed to allocate memory */
+
+	block->info = gp_current_task->tid | (BUF_TAG(block) << 16);
+	owner_link(block);
+	return (void*)((U32)block + BUF_HDR_SIZE);
 }
 
-int k_mem_dealloc(void *ptr) {
+static inline void* buf_alloc(size_t size) {
 	/*
-	 * Whenever we deallocate, we are adding nodes to the linked list before convolascing.
 	 *
-	 * We iterate through the free chunks untli we pass the address, then go back
-	 * to the previous free chunk and use chunk size to interate through allocated chunks.
+	 * The logic is simple:
+	 * After a few sanity checks, we find a free block of the same size or larger.
+	 * First fit walks the address ordered free list, TLSF looks it up in its bitmaps,
+	 * best fit walks down its tree.
+	 *
+	 * IF IT IS LARGER, we split it into an occupied block (the front)
+	 * and a free block (the rest), the rest goes back to the free list.
+	 * For first fit the rest simply takes the place of the block in the list.
 	 *
-	 * Once we reach the address we are good! Otherwise, if we pass the free chunk we
-	 * stopped at we are in trouble and exit.
+	 * IF IT IS THE SAME (or the rest would be too small to be a block),
+	 * we just remove the block from the free list.
 	 *
-	 * Now, we simply remove it from the linked list. If we are at the head, then set head to this.
 	 */
 
-	if (ptr == NULL) {
-	    	return RTX_OK;
-	    }
+    /* return NULL if given size is 0 or mem_init has not been run*/
+	if ((size == 0) || (g_heap_start == 0) || (size >= g_heap_end - g_heap_start)) {
+		return NULL;
+	}
 
-		Buffer* curr = head;
-		Buffer* prev = NULL;
-		while (curr != NULL && (U32)curr < (U32)ptr) {
-			prev = curr;
-			curr = curr->next;
-		}
+	size = PAD(size); /* bit magic goes fast with malloc inline. dont inline dealloc */
+	if (size < BUF_MIN_SIZE) { /* it has to hold the free list links and footer once it is freed */
+		size = BUF_MIN_SIZE;
+	}
 
-		/* curr has past ptr, perform linear search from prev to curr */
+	if (g_mem_algo == SEG_FIT && size <= SIZE_CLASS_MAX) {
+		return size_class_alloc(size);
+	}
+	return buf_alloc_fit(size);
+}
 
-		Buffer* target = first_buf;
-		if (prev != NULL) {
-			target = (Buffer*)((U32)prev + prev->size + sizeof(Buffer));
+/* take a block of size (padded) bytes from the free list(s) */
+static void* buf_alloc_fit(U32 size) {
+	Buffer* curr;
+	if (g_mem_algo == TLSF) {
+		curr = tlsf_find(size);
+		if (curr != NULL) {
+			tlsf_remove(curr);
+		}
+	} else if (g_mem_algo == BEST_FIT) {
+		curr = bt_find(size);
+		if (curr != NULL) {
+			bt_remove(curr);
 		}
+	} else {
+		/* loop through free structs */
+		curr = head;
+		while (curr != NULL && BUF_SIZE(curr) < size) {
+			curr = (Buffer*)curr->next;
+		}
+	}
 
-		while ((U32)target + sizeof(Buffer) != (U32)ptr) {
-			if ((U32)target >= (U32)curr || (U32)target >= (U32)RAM_END) {
-				/* did not find ptr */
-				return RTX_ERR;
-			}
-			target = (Buffer*)((U32)target + target->size + sizeof(Buffer));
+	if (curr == NULL) {
+		if (size_class_flush() + k_slab_shrink() > 0) { /* cached blocks went back to the heap, give it another go */
+			return buf_alloc_fit(size);
 		}
+		return NULL;	/* failed to allocate memory */
+	}
 
+	U32 curr_size = BUF_SIZE(curr);
+	if (curr_size >= size + BUF_HDR_SIZE + BUF_MIN_SIZE) { /* enough room to break into 2 blocks */
+		buf_set_used(curr, size, gp_current_task->tid);
+		Buffer* new_buffer = BUF_NEXT_PHYS(curr);
+		new_buffer->size = 0;
+		buf_set_free(new_buffer, curr_size - size - BUF_HDR_SIZE);
+		new_buffer->info = 0;
 
-		if(target->tid != gp_current_task->tid)
-		{
-			return RTX_ERR;
+		if (ALGO_BY_SIZE(g_mem_algo)) {
+			sized_insert(new_buffer);
+		} else {
+			ff_replace(curr, new_buffer);
 		}
+	} else { /* if exact size, remove curr from the free list */
+		if (!ALGO_BY_SIZE(g_mem_algo)) {
+			ff_unlink(curr);
+		}
+		buf_set_used(curr, curr_size, gp_current_task->tid);
+	}
 
-		/* deallocate target, insert into linked list */
-		target->next = curr;
+	owner_link(curr);
+	return (void*)((U32)curr + BUF_HDR_SIZE); /* pointer to allocated memory */
+}
 
-		if (prev != NULL) { /* idk why but this is faster than putting this in the next if lol */
-			prev->next = target;
-		}
+/*
+ * an allocated block leaves its owner's list and goes back to the heap, or onto its
+ * size class list under SEG_FIT. Returns the free block it ended up in, NULL if cached
+ */
+static Buffer* buf_release(Buffer *target, Buffer *from) {
+	owner_unlink(target);
+	if (g_mem_algo == SEG_FIT && BUF_SIZE(target) <= SIZE_CLASS_MAX && size_class_push(target)) {
+		return NULL;
+	}
+	return buf_free(target, from);
+}
 
-		/* merge with next if next chunk is free (in linked list)*/
-		if ((Buffer*)((U32)target + target->size + sizeof(Buffer)) == curr) {
-			target->size = target->size + curr->size + sizeof(Buffer); /* add set next */
-			target->next = curr->next;
-		}
+static int buf_dealloc(void *ptr) {
+	/*
+	 * We check ptr is a live block by looking at its header, and that the caller
+	 * owns it. Then it leaves its owner's list and buf_free() coalesces it,
+	 * unless SEG_FIT parks it on its size class list.
+	 */
 
-		if (prev != NULL) {
-			/* merge with previous if previous chunk is free (in linked list) */
-			if ((Buffer*)((U32)prev + prev->size + sizeof(Buffer)) == target ) {
-				prev->size = prev->size + target->size + sizeof(Buffer);
-				prev->next = target->next;
-				target = prev;
-			}
-		}
+	if (ptr == NULL) {
+		return RTX_OK;
+	}
 
-		/* check if head needs to be updated. */
-		if ((U32)target < (U32)head) {
-			head = target;
-		}
+	Buffer* target = buf_from_ptr(ptr);
+	if (buf_check_free(ptr, target) != RTX_OK || target == NULL) {
+		/* not a block we handed out, or it was freed already */
+		return RTX_ERR;
+	}
+
+	if(BUF_TID(target) != gp_current_task->tid)
+	{
+		return RTX_ERR;
+	}
 
+	buf_release(target, NULL);
 	return RTX_OK;
 }
 
-int k_mem_count_extfrag(size_t size) {
-    Buffer* curr = head;
-    int count = 0;
+inline void* k_mem_alloc(size_t size) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2); /* only the statistics time the call, the trace records the end */
+#endif /* MEM_STATS */
+	void *ptr = buf_alloc(size);
+	U32 end = timer_get_current_val(2);
+#ifdef MEM_STATS
+	mem_stats_alloc(ptr, start - end); /* the timer counts down */
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+	mem_trace_add(MEM_TRACE_ALLOC, gp_current_task->tid, size, ptr, end);
+#endif /* MEM_TRACE */
+	return ptr;
+#else
+	return buf_alloc(size);
+#endif /* MEM_STATS || MEM_TRACE */
+}
 
-    while (curr != NULL) {
-    	if (curr->size + sizeof(Buffer) < (U32)size) {
-    		count += 1;
+int k_mem_dealloc(void *ptr) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2);
+#endif /* MEM_STATS */
+	Buffer *block = (ptr != NULL) ? buf_from_ptr(ptr) : NULL;
+	U32 size = (block != NULL) ? BUF_SIZE(block) : 0;
+	int result = buf_dealloc(ptr);
+	U32 end = timer_get_current_val(2);
+	if (result == RTX_OK && ptr != NULL) {
+#ifdef MEM_STATS
+		mem_stats_dealloc(size, start - end);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+		mem_trace_add(MEM_TRACE_DEALLOC, gp_current_task->tid, size, ptr, end);
+#endif /* MEM_TRACE */
+	}
+	return result;
+#else
+	return buf_dealloc(ptr);
+#endif /* MEM_STATS || MEM_TRACE */
+}
+
+/* give the tail of an allocated block past size bytes back to the heap, it merges with a free next */
+static void buf_trim(Buffer *block, U32 size) {
+	U32 curr_size = BUF_SIZE(block);
+	if (curr_size >= size + BUF_HDR_SIZE + BUF_MIN_SIZE) {
+		task_t tid = BUF_TID(block);
+		buf_set_used(block, size, tid);
+		Buffer *rest = BUF_NEXT_PHYS(block);
+		rest->size = 0;
+		buf_set_used(rest, curr_size - size - BUF_HDR_SIZE, tid);
+		buf_free(rest, NULL);
+	}
+}
+
+/*
+ * resize the block ptr points to, keeping its contents up to the smaller of both sizes.
+ * A block shrinks in place by splitting off its tail, and grows in place by absorbing
+ * the free block right after it. Only when that one is missing or too small does it
+ * move: alloc, copy, dealloc.
+ * ptr NULL is an alloc, size 0 a dealloc. On failure ptr is left as it was and NULL is returned.
+ */
+static void* buf_realloc(void *ptr, size_t size) {
+	if (ptr == NULL) {
+		return buf_alloc(size);
+	}
+	Buffer *block = buf_from_ptr(ptr);
+	if (block == NULL || BUF_TID(block) != gp_current_task->tid) {
+		return NULL;
+	}
+	if (size == 0) {
+		buf_dealloc(ptr);
+		return NULL;
+	}
+	if (size >= g_heap_end - g_heap_start) {
+		return NULL;
+	}
+
+	U32 want = PAD(size);
+	if (want < BUF_MIN_SIZE) {
+		want = BUF_MIN_SIZE;
+	}
+	U32 curr_size = BUF_SIZE(block);
+	task_t tid = BUF_TID(block);
+
+	Buffer *next = buf_next_free(block);
+	if (want > curr_size && next != NULL && curr_size + BUF_HDR_SIZE + BUF_SIZE(next) >= want) {
+		/* grow into next, whatever is left of it stays free in its place */
+		U32 merged = curr_size + BUF_HDR_SIZE + BUF_SIZE(next);
+		if (merged >= want + BUF_HDR_SIZE + BUF_MIN_SIZE) {
+			/* rest may start inside the header of next, so take next off its list first */
+			Buffer *rest = (Buffer*)((U32)block + BUF_HDR_SIZE + want);
+			if (ALGO_BY_SIZE(g_mem_algo)) {
+				sized_remove(next);
+			} else {
+				ff_replace(next, rest);
+			}
+			buf_set_used(block, want, tid);
+			rest->size = 0;
+			buf_set_free(rest, merged - want - BUF_HDR_SIZE);
+			rest->info = 0;
+			if (ALGO_BY_SIZE(g_mem_algo)) {
+				sized_insert(rest);
+			}
+		} else {
+			if (ALGO_BY_SIZE(g_mem_algo)) {
+				sized_remove(next);
+			} else {
+				ff_unlink(next);
+			}
+			buf_set_used(block, merged, tid);
+		}
+		return ptr;
+	}
+
+	if (want <= curr_size) {
+		buf_trim(block, want);
+		return ptr;
+	}
+
+	void *moved = buf_alloc(size);
+	if (moved == NULL) {
+		return NULL;
+	}
+	U32 *src = (U32*)ptr;
+	U32 *dst = (U32*)moved;
+	for (U32 i = 0; i < curr_size / 4; i++) {
+		dst[i] = src[i];
+	}
+	buf_dealloc(ptr);
+	return moved;
+}
+
+void* k_mem_realloc(void *ptr, size_t size) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2);
+#endif /* MEM_STATS */
+	Buffer *block = (ptr != NULL) ? buf_from_ptr(ptr) : NULL;
+	U32 old_size = (block != NULL && BUF_TID(block) == gp_current_task->tid) ? BUF_SIZE(block) : 0;
+	void *moved = buf_realloc(ptr, size);
+	U32 end = timer_get_current_val(2);
+
+	/* counted as a dealloc of the old block and an alloc of the new one */
+	if (old_size != 0 && (moved != NULL || size == 0)) {
+#ifdef MEM_STATS
+		mem_stats_dealloc(old_size, 0);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+		mem_trace_add(MEM_TRACE_DEALLOC, gp_current_task->tid, old_size, ptr, end);
+#endif /* MEM_TRACE */
+	}
+	if (size != 0 && (moved != NULL || ptr == NULL)) {
+#ifdef MEM_STATS
+		mem_stats_alloc(moved, start - end);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+		mem_trace_add(MEM_TRACE_ALLOC, gp_current_task->tid, size, moved, end);
+#endif /* MEM_TRACE */
+	}
+	return moved;
+#else
+	return buf_realloc(ptr, size);
+#endif /* MEM_STATS || MEM_TRACE */
+}
+
+/*
+ * size bytes starting on a multiple of align, a power of two.
+ * We take a block big enough to hold the request at any alignment, then cut it down:
+ * the slack in front becomes a free block of its own (merging with a free previous
+ * block), and buf_trim() returns the tail. Nothing but the padding of size is lost.
+ */
+static void* buf_alloc_aligned(size_t size, size_t align) {
+	if (align == 0 || (align & (align - 1)) != 0) {
+		return NULL;
+	}
+	if (align <= 8) { /* every block is 8 byte aligned anyway */
+		return buf_alloc(size);
+	}
+	if ((size == 0) || (g_heap_start == 0) || (size >= g_heap_end - g_heap_start) || (align >= g_heap_end - g_heap_start)) {
+		return NULL;
+	}
+
+	U32 want = PAD(size);
+	if (want < BUF_MIN_SIZE) {
+		want = BUF_MIN_SIZE;
+	}
+	/* straight from the heap even under SEG_FIT, the size classes hold nothing this big */
+	U32 addr = (U32)buf_alloc_fit(want + align + BUF_HDR_SIZE + BUF_MIN_SIZE);
+	if (addr == 0) {
+		return NULL;
+	}
+
+	Buffer *block = (Buffer*)(addr - BUF_HDR_SIZE);
+	if ((addr & (align - 1)) != 0) {
+		/* the slack in front has to be big enough to be a block */
+		U32 aligned = (addr + BUF_HDR_SIZE + BUF_MIN_SIZE + align - 1) & ~(align - 1);
+		Buffer *lead = block;
+		U32 end = addr + BUF_SIZE(lead);
+		task_t tid = BUF_TID(lead);
+
+		owner_unlink(lead);
+		block = (Buffer*)(aligned - BUF_HDR_SIZE);
+		block->size = 0;
+		buf_set_used(block, end - aligned, tid);
+		buf_set_used(lead, (U32)block - addr, tid);
+		buf_free(lead, NULL);
+		owner_link(block);
+	}
+	buf_trim(block, want);
+	return (void*)((U32)block + BUF_HDR_SIZE);
+}
+
+void* k_mem_alloc_aligned(size_t size, size_t align) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2);
+#endif /* MEM_STATS */
+	void *ptr = buf_alloc_aligned(size, align);
+	U32 end = timer_get_current_val(2);
+#ifdef MEM_STATS
+	mem_stats_alloc(ptr, start - end);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+	mem_trace_add(MEM_TRACE_ALLOC, gp_current_task->tid, size, ptr, end); /* replays as a plain alloc */
+#endif /* MEM_TRACE */
+	return ptr;
+#else
+	return buf_alloc_aligned(size, align);
+#endif /* MEM_STATS || MEM_TRACE */
+}
+
+/*
+ * count blocks of size bytes in ptrs, all or nothing.
+ * When one free block holds them all (always the case on a fresh heap) we take it
+ * with a single search and cut it up, so the blocks also end up next to each other.
+ * SEG_FIT serves small sizes from its size classes, which refill in batches anyway.
+ */
+static int buf_alloc_n(size_t size, int count, void **ptrs) {
+	if (ptrs == NULL || count <= 0 || size == 0 || g_heap_start == 0 || size >= g_heap_end - g_heap_start) {
+		return RTX_ERR;
+	}
+
+	U32 want = PAD(size);
+	if (want < BUF_MIN_SIZE) {
+		want = BUF_MIN_SIZE;
+	}
+	int done = 0;
+	if (!(g_mem_algo == SEG_FIT && want <= SIZE_CLASS_MAX) && count <= (g_heap_end - g_heap_start) / (want + BUF_HDR_SIZE)) {
+		U32 addr = (U32)buf_alloc_fit(count * (want + BUF_HDR_SIZE) - BUF_HDR_SIZE);
+		if (addr != 0) {
+			Buffer *block = (Buffer*)(addr - BUF_HDR_SIZE);
+			task_t tid = BUF_TID(block);
+			U32 left = BUF_SIZE(block);
+			for (; done < count - 1; done++) {
+				buf_set_used(block, want, tid);
+				left -= want + BUF_HDR_SIZE;
+				ptrs[done] = (void*)((U32)block + BUF_HDR_SIZE);
+
+				block = BUF_NEXT_PHYS(block);
+				block->size = 0;
+				buf_set_used(block, left, tid); /* the last one keeps what could not be split off */
+				owner_link(block);
+			}
+			ptrs[done++] = (void*)((U32)block + BUF_HDR_SIZE);
+		}
+	}
+
+	for (; done < count; done++) {
+		ptrs[done] = buf_alloc(want);
+		if (ptrs[done] == NULL) {
+			while (done > 0) {
+				buf_dealloc(ptrs[--done]);
+			}
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+}
+
+/*
+ * sorts ptrs by address and checks every entry is a live block of the caller,
+ * at most once. NULL entries are allowed and end up in front
+ */
+static int buf_sort_check(void **ptrs, int count) {
+	if (ptrs == NULL || count < 0) {
+		return RTX_ERR;
+	}
+	/* insertion sort, a burst is short and often already in order */
+	for (int i = 1; i < count; i++) {
+		void *ptr = ptrs[i];
+		int j = i;
+		while (j > 0 && (U32)ptrs[j - 1] > (U32)ptr) {
+			ptrs[j] = ptrs[j - 1];
+			j--;
+		}
+		ptrs[j] = ptr;
+	}
+	for (int i = 0; i < count; i++) {
+		if (ptrs[i] == NULL) {
+			continue;
+		}
+		Buffer *block = buf_from_ptr(ptrs[i]);
+		if (buf_check_free(ptrs[i], block) != RTX_OK || block == NULL || BUF_TID(block) != gp_current_task->tid || (i > 0 && ptrs[i - 1] == ptrs[i])) {
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+}
+
+#if !defined(MEM_STATS) && !defined(MEM_TRACE)
+/*
+ * frees the blocks in ptrs, which come out sorted by address. Nothing is freed
+ * unless every entry is one of the caller's blocks.
+ * In address order a block either merges with the block freed before it, or finds its
+ * place in the first fit list by walking on from there: one pass over the list in total.
+ */
+static int buf_dealloc_n(void **ptrs, int count) {
+	if (buf_sort_check(ptrs, count) != RTX_OK) {
+		return RTX_ERR;
+	}
+	Buffer *from = NULL;
+	for (int i = 0; i < count; i++) {
+		if (ptrs[i] != NULL) {
+			Buffer *freed = buf_release((Buffer*)((U32)ptrs[i] - BUF_HDR_SIZE), from);
+			if (freed != NULL) {
+				from = freed;
+			}
+		}
+	}
+	return RTX_OK;
+}
+#endif /* !MEM_STATS && !MEM_TRACE */
+
+int k_mem_alloc_n(size_t size, int count, void **ptrs) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2);
+#endif /* MEM_STATS */
+	int result = buf_alloc_n(size, count, ptrs);
+	U32 end = timer_get_current_val(2);
+	/* one record per block, the time of the whole batch is shared between them */
+	for (int i = 0; i < count && ptrs != NULL; i++) {
+		void *ptr = (result == RTX_OK) ? ptrs[i] : NULL;
+#ifdef MEM_STATS
+		mem_stats_alloc(ptr, (start - end) / count);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+		mem_trace_add(MEM_TRACE_ALLOC, gp_current_task->tid, size, ptr, end);
+#endif /* MEM_TRACE */
+	}
+	return result;
+#else
+	return buf_alloc_n(size, count, ptrs);
+#endif /* MEM_STATS || MEM_TRACE */
+}
+
+int k_mem_dealloc_n(void **ptrs, int count) {
+#if defined(MEM_STATS) || defined(MEM_TRACE)
+#ifdef MEM_STATS
+	U32 start = timer_get_current_val(2);
+#endif /* MEM_STATS */
+	if (buf_sort_check(ptrs, count) != RTX_OK) {
+		return RTX_ERR;
+	}
+	Buffer *from = NULL;
+	for (int i = 0; i < count; i++) {
+		if (ptrs[i] != NULL) {
+			Buffer *block = (Buffer*)((U32)ptrs[i] - BUF_HDR_SIZE);
+			U32 size = BUF_SIZE(block);
+			Buffer *freed = buf_release(block, from);
+			if (freed != NULL) {
+				from = freed;
+			}
+			U32 end = timer_get_current_val(2);
+#ifdef MEM_STATS
+			mem_stats_dealloc(size, start - end);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+			mem_trace_add(MEM_TRACE_DEALLOC, gp_current_task->tid, size, ptrs[i], end);
+#endif /* MEM_TRACE */
+#ifdef MEM_STATS
+			start = end;
+#endif /* MEM_STATS */
+		}
+	}
+	return RTX_OK;
+#else
+	return buf_dealloc_n(ptrs, count);
+#endif /* MEM_STATS || MEM_TRACE */
+}
+
+/* give every block tid owns back to the heap, returns how many blocks that was */
+int k_mem_reclaim(task_t tid) {
+	int count = 0;
+
+#ifdef MEM_OWNER_LIST
+	U32 *owned = owner_head(tid);
+	while (*owned != 0) {
+		Buffer *block = (Buffer*)*owned;
+		*owned = block->next;
+#else
+	/* no owner lists, walk the heap. freeing only merges with blocks already passed or next */
+	Buffer *block = (Buffer*)g_heap_start;
+	while ((U32)block < g_heap_end) {
+		if ((block->size & (BUF_FREE | BUF_CACHED)) || BUF_TID(block) != tid) {
+			block = BUF_NEXT_PHYS(block);
+			continue;
+		}
+#endif /* MEM_OWNER_LIST */
+#ifdef MEM_STATS
+		mem_stats_dealloc(BUF_SIZE(block), 0);
+#endif /* MEM_STATS */
+#ifdef MEM_TRACE
+		mem_trace_add(MEM_TRACE_DEALLOC, tid, BUF_SIZE(block), (void*)((U32)block + BUF_HDR_SIZE), timer_get_current_val(2));
+#endif /* MEM_TRACE */
+#ifdef MEM_OWNER_LIST
+		buf_free(block, NULL);
+#else
+		block = buf_free(block, NULL);
+		block = BUF_NEXT_PHYS(block);
+#endif /* MEM_OWNER_LIST */
+		count++;
+	}
+
+	/* pools are kernel blocks, but they die with the task that created them */
+	for (int i = 0; i < MAX_POOLS; i++) {
+		if (g_pools[i].base != 0 && g_pools[i].owner == tid) {
+			k_dealloc_p_stack((void*)g_pools[i].base);
+			g_pools[i].base = 0;
+			g_pools[i].free_head = 0;
+		}
+	}
+
+	/* the size classes carved batches on the task's behalf, a task exit is a good time to trim them */
+	size_class_flush();
+	return count;
+}
+
+int k_mem_dump_task(task_t tid) {
+	if (tid >= MAX_TASKS) {
+		return RTX_ERR;
+	}
+
+	int count = 0;
+	U32 bytes = 0;
+	printf("task %d heap blocks:\r\n", tid);
+#ifdef MEM_OWNER_LIST
+	for (Buffer *block = (Buffer*)*owner_head(tid); block != NULL; block = (Buffer*)block->next) {
+#else
+	for (Buffer *block = (Buffer*)g_heap_start; (U32)block < g_heap_end; block = BUF_NEXT_PHYS(block)) {
+		if ((block->size & (BUF_FREE | BUF_CACHED)) || BUF_TID(block) != tid) {
+			continue;
+		}
+#endif /* MEM_OWNER_LIST */
+		printf("  0x%x %u bytes\r\n", (U32)block + BUF_HDR_SIZE, BUF_SIZE(block));
+		bytes += BUF_SIZE(block);
+		count++;
+	}
+	printf("task %d holds %d blocks, %u bytes\r\n", tid, count, bytes);
+	return count;
+}
+
+int k_mem_count_extfrag(size_t size) {
+    if (g_mem_algo == TLSF) {
+    	return tlsf_count_extfrag(size);
+    }
+    if (g_mem_algo == BEST_FIT) {
+    	return bt_count_extfrag(size);
+    }
+
+    Buffer* curr = head;
+    int count = 0;
+
+    while (curr != NULL) {
+    	if (BUF_SIZE(curr) + BUF_HDR_SIZE < (U32)size) {
+    		count += 1;
     	}
-    	curr = curr->next;
+    	curr = (Buffer*)curr->next;
     }
     return count;
 }
 
+/*
+ * fill buffer with the counters kept since the last k_mem_init_algo() and a fresh
+ * look at the free blocks. RTX_ERR if the kernel was built without MEM_STATS
+ */
+int k_mem_get_stats(RTX_MEM_STATS *buffer) {
+#ifdef MEM_STATS
+	if (buffer == NULL) {
+		return RTX_ERR;
+	}
+
+	*buffer = g_mem_stats;
+	buffer->largest_free = 0;
+	buffer->free_blocks = 0;
+	buffer->free_bytes = 0;
+
+	/* walk the blocks in address order, that works the same for every algorithm */
+	for (Buffer *block = (Buffer*)g_heap_start; (U32)block < g_heap_end; block = BUF_NEXT_PHYS(block)) {
+		if (block->size & BUF_FREE) {
+			buffer->free_blocks++;
+			buffer->free_bytes += BUF_SIZE(block);
+			if (BUF_SIZE(block) > buffer->largest_free) {
+				buffer->largest_free = BUF_SIZE(block);
+			}
+		}
+	}
+	return RTX_OK;
+#else
+	return RTX_ERR;
+#endif /* MEM_STATS */
+}
+
+/*
+ * walk the whole heap and check every header, the free list(s) and the size class lists.
+ * Says what is wrong with the first bad block over UART.
+ * RTX_OK if the heap is sane, RTX_ERR if not or if the kernel was built without MEM_CHECK.
+ * The null task calls this when there is nothing else to do, see task_null()
+ */
+int k_mem_check(void) {
+#ifdef MEM_CHECK
+	int free_blocks = 0;
+	Buffer *prev = NULL;
+	for (Buffer *block = (Buffer*)g_heap_start; (U32)block < g_heap_end; block = BUF_NEXT_PHYS(block)) {
+		const char *why = buf_check(block);
+		BOOL prev_free = (prev != NULL && (prev->size & BUF_FREE));
+		if (why == NULL && prev_free != ((block->size & BUF_PREV_FREE) != 0)) {
+			why = "has BUF_PREV_FREE wrong";
+		} else if (why == NULL && prev_free && (block->size & BUF_FREE)) {
+			why = "was not coalesced with the free block in front of it";
+		}
+		if (why != NULL) {
+			buf_check_report((U32)block, why);
+			return RTX_ERR;
+		}
+		if (block->size & BUF_FREE) {
+			free_blocks++;
+		}
+		prev = block;
+	}
+
+	/* every free block sits in the free list(s) once, the first fit list is address ordered */
+	int listed = 0;
+	if (ALGO_BY_SIZE(g_mem_algo)) {
+		listed = k_mem_count_extfrag(0x7FFFFFFF);
+	} else {
+		for (Buffer *curr = head; curr != NULL && listed <= free_blocks; curr = (Buffer*)curr->next) {
+			if (!(curr->size & BUF_FREE) || (curr->next != 0 && curr->next <= (U32)curr)
+					|| (curr->next != 0 && ((Buffer*)curr->next)->prev != (U32)curr)) {
+				buf_check_report((U32)curr, "breaks the free list");
+				return RTX_ERR;
+			}
+			listed++;
+		}
+	}
+	if (listed != free_blocks) {
+		printf("k_mem: %d free blocks in the heap, %d in the free list(s)\r\n", free_blocks, listed);
+		return RTX_ERR;
+	}
+
+	for (int cls = 0; cls < SIZE_CLASSES; cls++) {
+		U32 count = 0;
+		for (Buffer *curr = (Buffer*)g_size_class_heads[cls]; curr != NULL && count <= g_size_class_count[cls]; curr = (Buffer*)curr->next) {
+			if (!(curr->size & BUF_CACHED) || buf_check(curr) != NULL) {
+				buf_check_report((U32)curr, "breaks its size class list");
+				return RTX_ERR;
+			}
+			count++;
+		}
+		if (count != g_size_class_count[cls]) {
+			printf("k_mem: size class %d should hold %u blocks, counted %u\r\n", cls, g_size_class_count[cls], count);
+			return RTX_ERR;
+		}
+	}
+	return RTX_OK;
+#else
+	return RTX_ERR;
+#endif /* MEM_CHECK */
+}
+
+/*
+ * print the trace over UART, oldest record first, and start a new one.
+ * returns the number of records printed, RTX_ERR if the kernel was built without MEM_TRACE.
+ *
+ * MEMTRACE BEGIN <bytes managed, heap and stack region> <records> <records lost to the ring wrapping>
+ * <op> <tid> <size> <ptr> <timer 2>     op is I (k_mem_init_algo, size is the algorithm),
+ * ...                                   A (alloc, ptr 0 if it failed) or F (dealloc)
+ * MEMTRACE END
+ */
+int k_mem_trace_dump(void) {
+#ifdef MEM_TRACE
+	U32 count = (g_mem_trace_count < MEM_TRACE_LEN) ? g_mem_trace_count : MEM_TRACE_LEN;
+	U32 first = g_mem_trace_count - count;
+
+	printf("MEMTRACE BEGIN %u %u %u\r\n", g_buddy_end - g_heap_start, count, first);
+	for (U32 i = first; i < g_mem_trace_count; i++) {
+		MEM_TRACE_REC *rec = &g_mem_trace[i % MEM_TRACE_LEN];
+		char op = (rec->op == MEM_TRACE_ALLOC) ? 'A' : (rec->op == MEM_TRACE_DEALLOC) ? 'F' : 'I';
+		printf("%c %u %u %x %u\r\n", op, rec->tid, rec->size, rec->ptr, rec->time);
+	}
+	printf("MEMTRACE END\r\n");
+
+	g_mem_trace_count = 0;
+	return count;
+#else
+	return RTX_ERR;
+#endif /* MEM_TRACE */
+}
+
+/*
+ *===========================================================================
+ *          TLSF: two-level segregated fit, O(1) alloc and dealloc
+ *===========================================================================
+ */
+
+/*
+ * Free blocks are kept in TLSF_FL_COUNT x TLSF_SL_COUNT segregated lists.
+ * The first level splits sizes by power of two, the second level splits every
+ * power of two range linearly into TLSF_SL_COUNT lists. Two bitmaps record
+ * which lists are non-empty, so finding a free block is a couple of CLZ instead of a walk.
+ * Coalescing uses the boundary tags like first fit does.
+ */
+
+U32 g_tlsf_fl_bitmap = 0;
+U32 g_tlsf_sl_bitmap[TLSF_FL_COUNT];
+U32 g_tlsf_heads[TLSF_FL_COUNT][TLSF_SL_COUNT]; /* address of the first free block in each list, 0 if empty */
+
+/* index of the most significant set bit, x must not be 0 */
+static U32 tlsf_fls(U32 x) {
+	return 31 - __clz(x);
+}
+
+static void tlsf_mapping(U32 size, U32 *fl, U32 *sl) {
+	if (size < TLSF_SMALL_BLOCK) {
+		*fl = 0;
+		*sl = size >> TLSF_ALIGN_LOG2;
+	} else {
+		U32 msb = tlsf_fls(size);
+		*sl = (size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT; /* drop the leading 1 */
+		*fl = msb - (TLSF_FL_SHIFT - 1);
+	}
+}
+
+/* like tlsf_mapping but rounds up to the next list, so every block in it is big enough */
+static void tlsf_mapping_search(U32 size, U32 *fl, U32 *sl) {
+	if (size >= TLSF_SMALL_BLOCK) {
+		size += (1 << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+	}
+	tlsf_mapping(size, fl, sl);
+}
+
+void tlsf_init(void) {
+	for (int i = 0; i < TLSF_FL_COUNT; i++) {
+		g_tlsf_sl_bitmap[i] = 0;
+		for (int j = 0; j < TLSF_SL_COUNT; j++) {
+			g_tlsf_heads[i][j] = 0;
+		}
+	}
+	g_tlsf_fl_bitmap = 0;
+}
+
+void tlsf_insert(Buffer *block) {
+	U32 fl, sl;
+	tlsf_mapping(BUF_SIZE(block), &fl, &sl);
+
+	U32 first = g_tlsf_heads[fl][sl];
+	block->next = first;
+	block->prev = 0;
+	if (first != 0) {
+		((Buffer*)first)->prev = (U32)block;
+	}
+	g_tlsf_heads[fl][sl] = (U32)block;
+
+	g_tlsf_fl_bitmap |= (1U << fl);
+	g_tlsf_sl_bitmap[fl] |= (1U << sl);
+}
+
+/* must be called before the size of the block changes */
+void tlsf_remove(Buffer *block) {
+	U32 fl, sl;
+	tlsf_mapping(BUF_SIZE(block), &fl, &sl);
+
+	if (block->next != 0) {
+		((Buffer*)block->next)->prev = block->prev;
+	}
+	if (block->prev != 0) {
+		((Buffer*)block->prev)->next = block->next;
+	} else { /* at head */
+		g_tlsf_heads[fl][sl] = block->next;
+		if (block->next == 0) {
+			g_tlsf_sl_bitmap[fl] &= ~(1U << sl);
+			if (g_tlsf_sl_bitmap[fl] == 0) {
+				g_tlsf_fl_bitmap &= ~(1U << fl);
+			}
+		}
+	}
+}
+
+/* a free block of at least size bytes, NULL if there is none. the block stays in its list */
+Buffer* tlsf_find(U32 size) {
+	U32 fl, sl;
+	tlsf_mapping_search(size, &fl, &sl);
+
+	U32 sl_map = g_tlsf_sl_bitmap[fl] & (~0U << sl);
+	if (sl_map == 0) {
+		/* nothing left in this first level, move to the next non-empty one */
+		U32 fl_map = (fl + 1 < TLSF_FL_COUNT) ? (g_tlsf_fl_bitmap & (~0U << (fl + 1))) : 0;
+		if (fl_map == 0) {
+			/* rounding up skipped the list that size itself maps to, its first block may still fit.
+			 * this is what lets a request for (almost) the whole heap succeed */
+			tlsf_mapping(size, &fl, &sl);
+			Buffer *block = (Buffer*)g_tlsf_heads[fl][sl];
+			return (block != NULL && BUF_SIZE(block) >= size) ? block : NULL;
+		}
+		fl = low_bit(fl_map);
+		sl_map = g_tlsf_sl_bitmap[fl];
+	}
+	sl = low_bit(sl_map);
+	return (Buffer*)g_tlsf_heads[fl][sl];
+}
+
+int tlsf_count_extfrag(size_t size) {
+	int count = 0;
+
+	for (int i = 0; i < TLSF_FL_COUNT; i++) {
+		if (g_tlsf_sl_bitmap[i] == 0) {
+			continue;
+		}
+		for (int j = 0; j < TLSF_SL_COUNT; j++) {
+			Buffer *curr = (Buffer*)g_tlsf_heads[i][j];
+			while (curr != NULL) {
+				if (BUF_SIZE(curr) + BUF_HDR_SIZE < (U32)size) {
+					count += 1;
+				}
+				curr = (Buffer*)curr->next;
+			}
+		}
+	}
+	return count;
+}
+
+/*
+ *===========================================================================
+ *          BEST FIT: red-black tree of free blocks, O(log n) alloc and dealloc
+ *===========================================================================
+ */
+
+/*
+ * Every free block is a node of one red-black tree ordered by size, then address,
+ * so the smallest block that fits is a walk down the tree and among blocks of the
+ * same size the lowest one wins. The tree lives in the free blocks themselves:
+ * next and prev are the left and right child, info (unused while a block is free)
+ * holds the parent with the colour in bit 0.
+ */
+
+Buffer *g_bt_root = NULL;
+
+#define BT_RED          0x1
+#define BT_LEFT(b)      ((Buffer*)(b)->next)
+#define BT_RIGHT(b)     ((Buffer*)(b)->prev)
+#define BT_PARENT(b)    ((Buffer*)((b)->info & ~BT_RED))
+#define BT_IS_RED(b)    ((b) != NULL && ((b)->info & BT_RED))
+
+void bt_init(void) {
+	g_bt_root = NULL;
+}
+
+static void bt_set_parent(Buffer *block, Buffer *parent) {
+	block->info = (U32)parent | (block->info & BT_RED);
+}
+
+static int bt_less(Buffer *a, Buffer *b) {
+	return BUF_SIZE(a) < BUF_SIZE(b) || (BUF_SIZE(a) == BUF_SIZE(b) && (U32)a < (U32)b);
+}
+
+/* hang child where old hung under parent */
+static void bt_replace_child(Buffer *parent, Buffer *old, Buffer *child) {
+	if (parent == NULL) {
+		g_bt_root = child;
+	} else if (BT_LEFT(parent) == old) {
+		parent->next = (U32)child;
+	} else {
+		parent->prev = (U32)child;
+	}
+}
+
+static void bt_rotate_left(Buffer *x) {
+	Buffer *y = BT_RIGHT(x);
+	x->prev = y->next;
+	if (y->next != 0) {
+		bt_set_parent(BT_LEFT(y), x);
+	}
+	bt_set_parent(y, BT_PARENT(x));
+	bt_replace_child(BT_PARENT(x), x, y);
+	y->next = (U32)x;
+	bt_set_parent(x, y);
+}
+
+static void bt_rotate_right(Buffer *x) {
+	Buffer *y = BT_LEFT(x);
+	x->next = y->prev;
+	if (y->prev != 0) {
+		bt_set_parent(BT_RIGHT(y), x);
+	}
+	bt_set_parent(y, BT_PARENT(x));
+	bt_replace_child(BT_PARENT(x), x, y);
+	y->prev = (U32)x;
+	bt_set_parent(x, y);
+}
+
+void bt_insert(Buffer *block) {
+	Buffer *parent = NULL;
+	Buffer *curr = g_bt_root;
+	while (curr != NULL) {
+		parent = curr;
+		curr = bt_less(block, curr) ? BT_LEFT(curr) : BT_RIGHT(curr);
+	}
+
+	block->next = 0;
+	block->prev = 0;
+	block->info = (U32)parent | BT_RED;
+	if (parent == NULL) {
+		g_bt_root = block;
+	} else if (bt_less(block, parent)) {
+		parent->next = (U32)block;
+	} else {
+		parent->prev = (U32)block;
+	}
+
+	/* a red block under a red parent, recolour or rotate upwards */
+	Buffer *node = block;
+	while (BT_IS_RED(BT_PARENT(node))) {
+		parent = BT_PARENT(node);
+		Buffer *grand = BT_PARENT(parent);
+		if (parent == BT_LEFT(grand)) {
+			Buffer *uncle = BT_RIGHT(grand);
+			if (BT_IS_RED(uncle)) {
+				parent->info &= ~BT_RED;
+				uncle->info &= ~BT_RED;
+				grand->info |= BT_RED;
+				node = grand;
+				continue;
+			}
+			if (node == BT_RIGHT(parent)) {
+				bt_rotate_left(parent);
+				parent = node;
+			}
+			parent->info &= ~BT_RED;
+			grand->info |= BT_RED;
+			bt_rotate_right(grand);
+			break;
+		} else {
+			Buffer *uncle = BT_LEFT(grand);
+			if (BT_IS_RED(uncle)) {
+				parent->info &= ~BT_RED;
+				uncle->info &= ~BT_RED;
+				grand->info |= BT_RED;
+				node = grand;
+				continue;
+			}
+			if (node == BT_LEFT(parent)) {
+				bt_rotate_right(parent);
+				parent = node;
+			}
+			parent->info &= ~BT_RED;
+			grand->info |= BT_RED;
+			bt_rotate_left(grand);
+			break;
+		}
+	}
+	g_bt_root->info &= ~BT_RED;
+}
+
+void bt_remove(Buffer *block) {
+	Buffer *child;
+	Buffer *parent;
+	U32 red;
+
+	if (block->next == 0 || block->prev == 0) {
+		child = (block->next != 0) ? BT_LEFT(block) : BT_RIGHT(block);
+		parent = BT_PARENT(block);
+		red = block->info & BT_RED;
+		if (child != NULL) {
+			bt_set_parent(child, parent);
+		}
+		bt_replace_child(parent, block, child);
+	} else {
+		/* the next bigger block has no left child, it takes the place of block */
+		Buffer *succ = BT_RIGHT(block);
+		while (succ->next != 0) {
+			succ = BT_LEFT(succ);
+		}
+		child = BT_RIGHT(succ);
+		red = succ->info & BT_RED;
+		if (BT_PARENT(succ) == block) {
+			parent = succ;
+		} else {
+			parent = BT_PARENT(succ);
+			if (child != NULL) {
+				bt_set_parent(child, parent);
+			}
+			parent->next = (U32)child;
+			succ->prev = block->prev;
+			bt_set_parent(BT_RIGHT(block), succ);
+		}
+		succ->next = block->next;
+		bt_set_parent(BT_LEFT(block), succ);
+		bt_replace_child(BT_PARENT(block), block, succ);
+		succ->info = block->info;
+	}
+
+	if (red) {
+		return;
+	}
+
+	/* a black node left, child is one black short. a NULL child is always on the side with the NULL slot */
+	while (child != g_bt_root && !BT_IS_RED(child)) {
+		if (child == BT_LEFT(parent)) {
+			Buffer *sibling = BT_RIGHT(parent);
+			if (BT_IS_RED(sibling)) {
+				sibling->info &= ~BT_RED;
+				parent->info |= BT_RED;
+				bt_rotate_left(parent);
+				sibling = BT_RIGHT(parent);
+			}
+			if (!BT_IS_RED(BT_LEFT(sibling)) && !BT_IS_RED(BT_RIGHT(sibling))) {
+				sibling->info |= BT_RED;
+				child = parent;
+				parent = BT_PARENT(child);
+				continue;
+			}
+			if (!BT_IS_RED(BT_RIGHT(sibling))) {
+				BT_LEFT(sibling)->info &= ~BT_RED;
+				sibling->info |= BT_RED;
+				bt_rotate_right(sibling);
+				sibling = BT_RIGHT(parent);
+			}
+			sibling->info = (sibling->info & ~BT_RED) | (parent->info & BT_RED);
+			parent->info &= ~BT_RED;
+			BT_RIGHT(sibling)->info &= ~BT_RED;
+			bt_rotate_left(parent);
+		} else {
+			Buffer *sibling = BT_LEFT(parent);
+			if (BT_IS_RED(sibling)) {
+				sibling->info &= ~BT_RED;
+				parent->info |= BT_RED;
+				bt_rotate_right(parent);
+				sibling = BT_LEFT(parent);
+			}
+			if (!BT_IS_RED(BT_LEFT(sibling)) && !BT_IS_RED(BT_RIGHT(sibling))) {
+				sibling->info |= BT_RED;
+				child = parent;
+				parent = BT_PARENT(child);
+				continue;
+			}
+			if (!BT_IS_RED(BT_LEFT(sibling))) {
+				BT_RIGHT(sibling)->info &= ~BT_RED;
+				sibling->info |= BT_RED;
+				bt_rotate_left(sibling);
+				sibling = BT_LEFT(parent);
+			}
+			sibling->info = (sibling->info & ~BT_RED) | (parent->info & BT_RED);
+			parent->info &= ~BT_RED;
+			BT_LEFT(sibling)->info &= ~BT_RED;
+			bt_rotate_right(parent);
+		}
+		child = g_bt_root;
+	}
+	if (child != NULL) {
+		child->info &= ~BT_RED;
+	}
+}
+
+/* smallest free block of at least size bytes, the lowest one if there are several */
+Buffer* bt_find(U32 size) {
+	Buffer *best = NULL;
+	Buffer *curr = g_bt_root;
+	while (curr != NULL) {
+		if (BUF_SIZE(curr) >= size) {
+			best = curr;
+			curr = BT_LEFT(curr);
+		} else {
+			curr = BT_RIGHT(curr);
+		}
+	}
+	return best;
+}
+
+/* the blocks come out smallest first, so only the ones that are counted get visited */
+int bt_count_extfrag(size_t size) {
+	int count = 0;
+	Buffer *curr = g_bt_root;
+	if (curr == NULL) {
+		return 0;
+	}
+	while (curr->next != 0) {
+		curr = BT_LEFT(curr);
+	}
+
+	while (curr != NULL && BUF_SIZE(curr) + BUF_HDR_SIZE < (U32)size) {
+		count++;
+		if (curr->prev != 0) { /* in order successor */
+			curr = BT_RIGHT(curr);
+			while (curr->next != 0) {
+				curr = BT_LEFT(curr);
+			}
+		} else {
+			Buffer *parent = BT_PARENT(curr);
+			while (parent != NULL && curr == BT_RIGHT(parent)) {
+				curr = parent;
+				parent = BT_PARENT(parent);
+			}
+			curr = parent;
+		}
+	}
+	return count;
+}
+
+/*
+ *===========================================================================
+ *          FIXED POOLS: N blocks of size S, O(1) alloc and dealloc
+ *===========================================================================
+ */
+
+int k_mem_pool_create(size_t blk_size, size_t num_blks) {
+	if (blk_size == 0 || num_blks == 0) {
+		return RTX_ERR;
+	}
+
+	blk_size = PAD(blk_size); /* keeps every block 8 byte aligned and big enough to hold the free list link */
+	if (num_blks > (g_heap_end - g_heap_start) / blk_size) { /* cannot possibly fit, also guards the multiply */
+		return RTX_ERR;
+	}
+
+	int pool_id = 0;
+	while (pool_id < MAX_POOLS && g_pools[pool_id].base != 0) {
+		pool_id++;
+	}
+	if (pool_id == MAX_POOLS) {
+		return RTX_ERR;
+	}
+
+	U32 map_words = (num_blks + 31) >> 5;
+	U32 data_size = blk_size * num_blks;
+	U8 *mem = (U8*)k_alloc_p_stack(data_size + (map_words << 2));
+	if (mem == NULL) {
+		return RTX_ERR;
+	}
+
+	Pool *pool = &g_pools[pool_id];
+	pool->base = (U32)mem;
+	pool->end = (U32)mem + data_size;
+	pool->blk_size = blk_size;
+	pool->num_free = num_blks;
+	pool->used_map = (U32*)(mem + data_size);
+	pool->owner = gp_current_task->tid;
+
+	for (U32 i = 0; i < map_words; i++) {
+		pool->used_map[i] = 0;
+	}
+
+	/* thread the free list through the blocks in address order */
+	U32 blk = pool->end - blk_size;
+	U32 next = 0;
+	while (1) {
+		*(U32*)blk = next;
+		next = blk;
+		if (blk == pool->base) {
+			break;
+		}
+		blk -= blk_size;
+	}
+	pool->free_head = pool->base;
+
+	return pool_id;
+}
+
+void* k_mem_pool_alloc(int pool_id) {
+	if (pool_id < 0 || pool_id >= MAX_POOLS) {
+		return NULL;
+	}
+
+	Pool *pool = &g_pools[pool_id];
+	U32 blk = pool->free_head;
+	if (blk == 0) { /* unused slot or pool exhausted */
+		return NULL;
+	}
+
+	pool->free_head = *(U32*)blk;
+	pool->num_free--;
+
+	U32 index = (blk - pool->base) / pool->blk_size;
+	pool->used_map[index >> 5] |= (1U << (index & 31));
+	return (void*)blk;
+}
+
+int k_mem_pool_dealloc(int pool_id, void *ptr) {
+	if (pool_id < 0 || pool_id >= MAX_POOLS) {
+		return RTX_ERR;
+	}
+
+	Pool *pool = &g_pools[pool_id];
+	U32 blk = (U32)ptr;
+	if (pool->base == 0 || blk < pool->base || blk >= pool->end) {
+		return RTX_ERR;
+	}
+
+	U32 index = (blk - pool->base) / pool->blk_size;
+	U32 bit = 1U << (index & 31);
+	if (blk != pool->base + index * pool->blk_size || (pool->used_map[index >> 5] & bit) == 0) {
+		/* not the start of a block, or the block is already free */
+		return RTX_ERR;
+	}
+
+	pool->used_map[index >> 5] &= ~bit;
+	*(U32*)blk = pool->free_head;
+	pool->free_head = blk;
+	pool->num_free++;
+	return RTX_OK;
+}
+
+int k_mem_pool_delete(int pool_id) {
+	if (pool_id < 0 || pool_id >= MAX_POOLS) {
+		return RTX_ERR;
+	}
+
+	Pool *pool = &g_pools[pool_id];
+	if (pool->base == 0 || pool->owner != gp_current_task->tid) {
+		return RTX_ERR;
+	}
+
+	/* blocks still handed out die with the pool, the owner is expected to know they are done */
+	if (k_dealloc_p_stack((void*)pool->base) != RTX_OK) {
+		return RTX_ERR;
+	}
+	pool->base = 0;
+	pool->free_head = 0;
+	return RTX_OK;
+}
+
+/*
+ *===========================================================================
+ *          STACK REGION: buddy allocator, O(log n) alloc and dealloc
+ *===========================================================================
+ */
+
+/*
+ * k_mem_init_algo() reserves the top of the heap for user stacks and mailboxes,
+ * so task churn cannot fragment the heap applications allocate from.
+ * Blocks are 1 << (BUDDY_MIN_LOG2 + k) bytes for order k. A block splits into two
+ * buddies of the next order down, and a freed block merges with its buddy whenever
+ * that one is free as well, so the region always goes back to one block.
+ *
+ * g_buddy_map has one entry per smallest block: 0 inside a block, order + 1 at the
+ * start of an allocated block, with BUDDY_FREE added while it is free.
+ * Free blocks of each order are in a list linked through their first two words.
+ */
+
+#define BUDDY_FREE          0x80
+#define BUDDY_BLOCKS        (1 << (BUDDY_ORDERS - 1))
+#define BUDDY_SIZE(k)       (1 << (BUDDY_MIN_LOG2 + (k)))
+#define BUDDY_INDEX(addr)   (((U32)(addr) - g_heap_end) >> BUDDY_MIN_LOG2)
+
+U32 g_buddy_orders = 0; /* orders the region has, 0 if the heap was too small for one */
+U32 g_buddy_heads[BUDDY_ORDERS]; /* first free block of each order, 0 if none */
+U8 g_buddy_map[BUDDY_BLOCKS];
+
+static void buddy_push(U32 addr, U32 k) {
+	U32 *link = (U32*)addr; /* link[0] next, link[1] prev */
+	link[0] = g_buddy_heads[k];
+	link[1] = 0;
+	if (g_buddy_heads[k] != 0) {
+		((U32*)g_buddy_heads[k])[1] = addr;
+	}
+	g_buddy_heads[k] = addr;
+	g_buddy_map[BUDDY_INDEX(addr)] = (k + 1) | BUDDY_FREE;
+}
+
+static void buddy_unlink(U32 addr, U32 k) {
+	U32 *link = (U32*)addr;
+	if (link[1] != 0) {
+		((U32*)link[1])[0] = link[0];
+	} else {
+		g_buddy_heads[k] = link[0];
+	}
+	if (link[0] != 0) {
+		((U32*)link[0])[1] = link[1];
+	}
+	g_buddy_map[BUDDY_INDEX(addr)] = 0;
+}
+
+/* the region starts at base and is one block of order orders - 1 */
+void buddy_init(U32 base, U32 orders) {
+	g_buddy_orders = orders;
+	g_buddy_end = (orders > 0) ? base + BUDDY_SIZE(orders - 1) : base;
+	for (U32 k = 0; k < BUDDY_ORDERS; k++) {
+		g_buddy_heads[k] = 0;
+	}
+	for (U32 i = 0; i < BUDDY_BLOCKS; i++) {
+		g_buddy_map[i] = 0;
+	}
+	if (orders > 0) {
+		buddy_push(base, orders - 1);
+	}
+}
+
+/* smallest block of at least size bytes, NULL if the region has none left */
+void* buddy_alloc(U32 size) {
+	U32 k = 0;
+	while (k < g_buddy_orders && BUDDY_SIZE(k) < size) {
+		k++;
+	}
+
+	U32 j = k;
+	while (j < g_buddy_orders && g_buddy_heads[j] == 0) {
+		j++;
+	}
+	if (j >= g_buddy_orders) {
+		return NULL;
+	}
+
+	U32 addr = g_buddy_heads[j];
+	buddy_unlink(addr, j);
+	while (j > k) { /* keep the front half, the back half is free */
+		j--;
+		buddy_push(addr + BUDDY_SIZE(j), j);
+	}
+	g_buddy_map[BUDDY_INDEX(addr)] = k + 1;
+	return (void*)addr;
+}
+
+int buddy_free(void *ptr) {
+	U32 addr = (U32)ptr;
+	if (addr < g_heap_end || addr >= g_buddy_end || ((addr - g_heap_end) & (BUDDY_SIZE(0) - 1)) != 0) {
+		return RTX_ERR;
+	}
+	U32 entry = g_buddy_map[BUDDY_INDEX(addr)];
+	if (entry == 0 || (entry & BUDDY_FREE)) { /* not the start of a block, or freed already */
+		return RTX_ERR;
+	}
+
+	U32 k = entry - 1;
+	g_buddy_map[BUDDY_INDEX(addr)] = 0;
+	while (k + 1 < g_buddy_orders) {
+		U32 buddy = g_heap_end + ((addr - g_heap_end) ^ BUDDY_SIZE(k));
+		if (g_buddy_map[BUDDY_INDEX(buddy)] != ((k + 1) | BUDDY_FREE)) {
+			break;
+		}
+		buddy_unlink(buddy, k);
+		if (buddy < addr) {
+			addr = buddy;
+		}
+		k++;
+	}
+	buddy_push(addr, k);
+	return RTX_OK;
+}
+
+/* a block from the stack region, or from the heap once the region is full */
+static void* stack_block_alloc(U32 size) {
+	void *ptr = buddy_alloc(size);
+	return (ptr != NULL) ? ptr : k_alloc_p_stack(size);
+}
+
+static int stack_block_dealloc(void *ptr) {
+	if ((U32)ptr >= g_heap_end && (U32)ptr < g_buddy_end) {
+		return buddy_free(ptr);
+	}
+	return k_dealloc_p_stack(ptr);
+}
+
+/* first address of the stack region, the heap ends right before it */
+U32 k_mem_get_split(void) {
+	return g_heap_end;
+}
+
+/*
+ *===========================================================================
+ *          SLAB CACHES: mailbox rings and other odd sized kernel objects
+ *===========================================================================
+ */
+
+/*
+ * Kernel objects come in few sizes (U_STACK_SIZE stacks, a handful of mailbox sizes).
+ * Power of two sizes from the smallest stack region block up, which stacks usually are,
+ * are stack region blocks already. Every other size, smaller powers of two included
+ * since a block would round them up to 1 << BUDDY_MIN_LOG2, gets a cache of slabs. A slab holds objs_per_slab objects in one
+ * SLAB_BYTES stack region block, and an object freed by k_tsk_exit() stays in its slab
+ * for the next k_tsk_create(), so task churn is a pop and a push instead of a search.
+ * Objects too big for a slab get a stack region block of their own.
+ *
+ * Each cache keeps at most one empty slab around, the rest go back to the region.
+ * When the heap runs dry k_slab_shrink() hands back the remaining empty slabs too.
+ */
+
+/* cache for size, or NULL. with create set an unused slot is taken for it */
+static SlabCache* slab_cache_get(U32 size, int create) {
+	SlabCache *unused = NULL;
+	for (int i = 0; i < SLAB_CACHES; i++) {
+		if (g_slab_caches[i].obj_size == size) {
+			return &g_slab_caches[i];
+		}
+		if (unused == NULL && g_slab_caches[i].obj_size == 0) {
+			unused = &g_slab_caches[i];
+		}
+	}
+
+	if (!create || unused == NULL) {
+		return NULL;
+	}
+	unused->obj_size = size;
+	unused->slabs = 0;
+	unused->objs_per_slab = (SLAB_BYTES - sizeof(Slab)) / size;
+	return unused;
+}
+
+static Slab* slab_grow(SlabCache *cache, U32 num_objs) {
+	U32 obj_size = cache->obj_size;
+	Slab *slab = (Slab*)stack_block_alloc(sizeof(Slab) + num_objs * obj_size);
+	cache->obj_size = obj_size; /* a failed first try runs k_slab_shrink(), which may have freed the slot */
+	if (slab == NULL) {
+		return NULL;
+	}
+
+	slab->num_used = 0;
+	slab->num_objs = num_objs;
+
+	/* thread the free list through the objects in address order */
+	U32 obj = SLAB_OBJS(slab) + (num_objs - 1) * cache->obj_size;
+	U32 next = 0;
+	for (U32 i = 0; i < num_objs; i++) {
+		*(U32*)obj = next;
+		next = obj;
+		obj -= cache->obj_size;
+	}
+	slab->free_head = next;
+
+	slab->next = cache->slabs;
+	cache->slabs = (U32)slab;
+	return slab;
+}
+
+/* unlink slab from cache and give it back to the heap, prev is the slab before it or NULL */
+static void slab_release(SlabCache *cache, Slab *prev, Slab *slab) {
+	if (prev != NULL) {
+		prev->next = slab->next;
+	} else {
+		cache->slabs = slab->next;
+	}
+	stack_block_dealloc(slab);
+}
+
+/* give every empty slab back to the heap, returns how many were released */
+int k_slab_shrink(void) {
+	int released = 0;
+
+	for (int i = 0; i < SLAB_CACHES; i++) {
+		SlabCache *cache = &g_slab_caches[i];
+		if (cache->obj_size == 0) {
+			continue;
+		}
+
+		Slab *prev = NULL;
+		Slab *slab = (Slab*)cache->slabs;
+		while (slab != NULL) {
+			Slab *next = (Slab*)slab->next;
+			if (slab->num_used == 0) {
+				slab_release(cache, prev, slab);
+				released++;
+			} else {
+				prev = slab;
+			}
+			slab = next;
+		}
+
+		if (cache->slabs == 0) { /* free the slot for another size */
+			cache->obj_size = 0;
+		}
+	}
+	return released;
+}
+
+/* a kernel owned object of size bytes, NULL if the stack region and the heap are out of memory */
+void* k_slab_alloc(size_t size) {
+	if (size == 0) {
+		return NULL;
+	}
+	size = PAD(size);
+	if (((size & (size - 1)) == 0 && size >= (1 << BUDDY_MIN_LOG2)) || size > SLAB_BYTES - sizeof(Slab)) {
+		return stack_block_alloc(size);
+	}
+
+	SlabCache *cache = slab_cache_get(size, 1);
+	if (cache == NULL && k_slab_shrink() > 0) {
+		cache = slab_cache_get(size, 1);
+	}
+	if (cache == NULL) { /* every slot is busy with another size */
+		return stack_block_alloc(size);
+	}
+
+	Slab *slab = (Slab*)cache->slabs;
+	while (slab != NULL && slab->free_head == 0) {
+		slab = (Slab*)slab->next;
+	}
+
+	if (slab == NULL) {
+		slab = slab_grow(cache, cache->objs_per_slab);
+		if (slab == NULL && cache->objs_per_slab > 1) { /* a whole slab does not fit, settle for one object */
+			slab = slab_grow(cache, 1);
+		}
+		if (slab == NULL) {
+			if (cache->slabs == 0) {
+				cache->obj_size = 0;
+			}
+			return NULL;
+		}
+	}
+
+	U32 obj = slab->free_head;
+	slab->free_head = *(U32*)obj;
+	slab->num_used++;
+	return (void*)obj;
+}
+
+/* return an object from k_slab_alloc(), size must be the size it was allocated with */
+int k_slab_dealloc(void *ptr, size_t size) {
+	if (ptr == NULL) {
+		return RTX_OK;
+	}
+	size = PAD(size);
+
+	U32 obj = (U32)ptr;
+	SlabCache *cache = slab_cache_get(size, 0);
+	Slab *slab = (cache != NULL) ? (Slab*)cache->slabs : NULL;
+	while (slab != NULL) {
+		U32 first = SLAB_OBJS(slab);
+		if (obj >= first && obj < first + slab->num_objs * size) {
+			break;
+		}
+		slab = (Slab*)slab->next;
+	}
+
+	if (slab == NULL) { /* a block of its own, see k_slab_alloc() */
+		return stack_block_dealloc(ptr);
+	}
+	if ((obj - SLAB_OBJS(slab)) % size != 0 || slab->num_used == 0) {
+		return RTX_ERR;
+	}
+
+	*(U32*)obj = slab->free_head;
+	slab->free_head = obj;
+	slab->num_used--;
+
+	if (slab->num_used == 0) { /* keep this one for the next alloc, any other empty slab goes back to the heap */
+		Slab *prev = NULL;
+		Slab *curr = (Slab*)cache->slabs;
+		while (curr != NULL) {
+			Slab *next = (Slab*)curr->next;
+			if (curr != slab && curr->num_used == 0) {
+				slab_release(cache, prev, curr);
+			} else {
+				prev = curr;
+			}
+			curr = next;
+		}
+	}
+	return RTX_OK;
+}
+
 #ifdef DEBUG_0
 void display_all_mem() {
 	printf("\r\n---------------start--------------------\r\n");
 
-	printf("first_buf address 0x%d\r\n", first_buf);
-	printf("head address 0x%d\r\n", head);
-	printf("RAM_END address 0x%d\r\n", RAM_END);
+	printf("heap start address 0x%x\r\n", g_heap_start);
+	printf("head address 0x%x\r\n", head);
+	printf("heap end address 0x%x\r\n", g_heap_end);
 
-	Buffer* temp = first_buf;
+	Buffer* temp = (Buffer*)g_heap_start;
 
-	while((U32)temp != RAM_END) {
-		printf("cur address: 0d%d | ", temp);
-		printf("next: 0d%d | ", temp -> next);
-		printf("size: %d | ", temp -> size);
-		printf("size + header struct: %d |\r\n", temp -> size + sizeof(Buffer));
+	while((U32)temp < g_heap_end) {
+		printf("cur address: 0x%x | ", temp);
+		printf("free: %d | ", temp -> size & BUF_FREE);
+		printf("size: %d | ", BUF_SIZE(temp));
+		printf("size + header: %d |\r\n", BUF_SIZE(temp) + BUF_HDR_SIZE);
 
-		temp = (Buffer*)((U32)temp + temp ->size + sizeof(Buffer));
+		temp = BUF_NEXT_PHYS(temp);
 	}
 	printf("---------------end--------------------\r\n\r\n");
 }
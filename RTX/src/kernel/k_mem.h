@@ -48,6 +48,69 @@
 // add 7 to x and then use bit mask to round down to nearest multiple of 8
 #define PAD(x) ((x+7) & ~(7))
 
+// new kernel and user stacks are filled with this, the words still holding it were never touched
+#define STACK_PAINT         0xDEADBEEF
+
+// heap algorithm k_mem_init() sets up, see k_mem_init_algo() to pick another one
+#define MEM_ALGO_DEFAULT    FIRST_FIT
+
+// keep a list of the blocks each task owns in its TCB, so k_mem_reclaim() on task exit and
+// k_mem_dump_task() only visit that task's blocks. The links make allocated block headers 16 bytes,
+// define MEM_SMALL_HEADER in the build settings for 8 byte headers and heap walks instead
+#if !defined(MEM_SMALL_HEADER) && !defined(MEM_OWNER_LIST)
+#define MEM_OWNER_LIST
+#endif
+
+// define MEM_STATS in the build settings (like DEBUG_0) to count allocations and time them, see k_mem_get_stats()
+//#define MEM_STATS
+
+// define MEM_CHECK in the build settings to check block headers on every dealloc and
+// walk the whole heap from the null task, see k_mem_check(). Without it none of that is built
+//#define MEM_CHECK
+
+// define MEM_TRACE in the build settings to record every heap operation, see k_mem_trace_dump()
+//#define MEM_TRACE
+#define MEM_TRACE_LEN       4096    /* records kept, older ones are overwritten */
+#define MEM_TRACE_INIT      0
+#define MEM_TRACE_ALLOC     1
+#define MEM_TRACE_DEALLOC   2
+
+typedef struct _mem_trace_rec { /* struct size: 16 */
+	U8 op;
+	U8 filler;
+	U16 tid;
+	U32 size; /* requested size for alloc, block size for dealloc, algorithm for init */
+	U32 ptr;
+	U32 time; /* timer 2 when the operation finished, counts down in us */
+} MEM_TRACE_REC;
+
+/*
+ * TLSF tuning
+ * second level splits every power of two range into 2^TLSF_SL_LOG2 lists,
+ * sizes below TLSF_SMALL_BLOCK all map linearly into first level 0
+ */
+#define TLSF_SL_LOG2        5
+#define TLSF_SL_COUNT       (1 << TLSF_SL_LOG2)
+#define TLSF_ALIGN_LOG2     3                                   /* 8 byte aligned, same as PAD() */
+#define TLSF_FL_SHIFT       (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_MAX         30                                  /* msb of the largest block, the DE1 has 1GB */
+#define TLSF_FL_COUNT       (TLSF_FL_MAX - TLSF_FL_SHIFT + 2)
+#define TLSF_SMALL_BLOCK    (1 << TLSF_FL_SHIFT)
+
+// SEG_FIT size classes, 8 << class bytes for class 0 .. SIZE_CLASSES - 1
+#define SIZE_CLASSES        5       /* 8, 16, 32, 64 and 128 bytes */
+#define SIZE_CLASS_MAX      (8 << (SIZE_CLASSES - 1))
+#define SIZE_CLASS_BATCH    8       /* blocks carved out of the heap at once when a class runs dry */
+#define SIZE_CLASS_KEEP     32      /* freed blocks a class holds on to, the rest coalesce as usual */
+
+// stack region: a buddy allocator at the top of RAM for user stacks and mailboxes
+#define BUDDY_MIN_LOG2      9       /* smallest block is U_STACK_SIZE */
+#define BUDDY_ORDERS        12      /* blocks of 0x200 .. 0x100000 bytes, the region is one biggest block */
+
+// slab caches for mailboxes, carved out of the stack region
+#define SLAB_CACHES         8       /* distinct object sizes cached at the same time */
+#define SLAB_BYTES          0x800   /* a slab is one stack region block, header and objects included */
+
 
 /*
  * ------------------------------------------------------------------------
@@ -55,12 +118,33 @@
  * ------------------------------------------------------------------------
  */
 int     k_mem_init          (void);
+int     k_mem_init_algo     (int algo);
 void   *k_mem_alloc         (size_t size);
 int     k_mem_dealloc       (void *ptr);
+void   *k_mem_realloc       (void *ptr, size_t size);
+void   *k_mem_alloc_aligned (size_t size, size_t align);
+int     k_mem_alloc_n       (size_t size, int count, void **ptrs);
+int     k_mem_dealloc_n     (void **ptrs, int count);
 int     k_mem_count_extfrag (size_t size);
-U32    *k_alloc_k_stack     (task_t tid);
-U32    *k_alloc_p_stack     (U16 stack_size);
+int     k_mem_get_stats     (RTX_MEM_STATS *buffer);
+int     k_mem_trace_dump    (void);
+int     k_mem_check         (void);
+U32     k_mem_get_split     (void);
+int     k_mem_reclaim       (task_t tid);
+int     k_mem_dump_task     (task_t tid);
+int     k_mem_pool_create   (size_t blk_size, size_t num_blks);
+void   *k_mem_pool_alloc    (int pool_id);
+int     k_mem_pool_dealloc  (int pool_id, void *ptr);
+int     k_mem_pool_delete   (int pool_id);
+U32    *k_alloc_k_stack     (size_t size);
+int     k_dealloc_k_stack   (U32 *hi, size_t size);
+void    k_stack_paint       (U32 *lo, U32 size);
+U32     k_stack_used        (U32 *lo, U32 size);
+U32    *k_alloc_p_stack     (size_t stack_size);
 int 	k_dealloc_p_stack	(void *ptr);
+void   *k_slab_alloc        (size_t size);
+int     k_slab_dealloc      (void *ptr, size_t size);
+int     k_slab_shrink       (void);
 #endif // ! K_MEM_H_
 
 /*
@@ -24,28 +24,32 @@ int k_mbx_create(size_t size) {
 #ifdef DEBUG_0
     printf("k_mbx_create: size = %d\r\n", size);
 #endif /* DEBUG_0 */
+    return k_mbx_create_tcb(gp_current_task, size);
+}
 
+/* gives p_tcb a mailbox of size bytes, real-time tasks get theirs when they are created */
+int k_mbx_create_tcb(TCB *p_tcb, size_t size) {
     // Mailbox initialization
     // set the tail to max value of U32, underflow on purpose
-    gp_current_task->mbTail = -1;
-    gp_current_task->mbHead = 0;
-    gp_current_task->mbSize = 0;
+    p_tcb->mbTail = -1;
+    p_tcb->mbHead = 0;
+    p_tcb->mbSize = 0;
 
     // EDGE CASES
-    if(gp_current_task->mbCapacity != 0 || size < MIN_MBX_SIZE)
+    if(p_tcb->mbCapacity != 0 || size < MIN_MBX_SIZE)
     {
     	// capacity is 0 by default, mbCapacity != 0 meaning already have a mailbox
     	return RTX_ERR;
     }
-    gp_current_task->mbCapacity = size;
 
     // Allocate (with kernel ownership) space for the mailbox
-    gp_current_task->mailbox = (U8*)k_alloc_p_stack(size);
-    if (gp_current_task->mailbox == NULL)
+    p_tcb->mailbox = (U8*)k_slab_alloc(size);
+    if (p_tcb->mailbox == NULL)
     {
     	// Not enough memory to allocate for mailbox
     	return RTX_ERR;
     }
+    p_tcb->mbCapacity = size;
 
     // NOTE: When a task exits, mailbox data is deallocated
     return RTX_OK;
@@ -60,12 +64,8 @@ int IRQ_send_msg(task_t receiver_tid, const void *buf) {
 		return returnVal;
 }
 
-int k_send_msg(task_t receiver_tid, const void *buf) {
-#ifdef DEBUG_0
-    printf("k_send_msg: receiver_tid = %d, buf=0x%x\r\n", receiver_tid, buf);
-#endif /* DEBUG_0 */
-
-    TCB *receiver = &g_tcbs[receiver_tid];
+/* puts the message in the mailbox of receiver, RTX_ERR if it has none or the message does not fit */
+static int mbxDeliver(TCB *receiver, const void *buf) {
     RTX_MSG_HDR *header = (RTX_MSG_HDR*)buf;
 
     // the cpyMsg condition will execute last after all other ones are checked, do not change the order
@@ -78,44 +78,43 @@ int k_send_msg(task_t receiver_tid, const void *buf) {
     {
     	return RTX_ERR;
     }
+    return RTX_OK;
+}
+
+int k_send_msg(task_t receiver_tid, const void *buf) {
+#ifdef DEBUG_0
+    printf("k_send_msg: receiver_tid = %d, buf=0x%x\r\n", receiver_tid, buf);
+#endif /* DEBUG_0 */
+
+    TCB *receiver = (receiver_tid < MAX_TASKS) ? g_tcbs[receiver_tid] : &g_tcb_dormant;
+    if (mbxDeliver(receiver, buf) != RTX_OK) {
+    	return RTX_ERR;
+    }
 
-    U8 prevState = receiver->state;
 	// Unblock blocked receivers
-	if (receiver->state == BLK_MSG) {
+    if (receiver->state == BLK_MSG) {
 		receiver->state = READY;
+		/*  if the priority of the unblocked task (Q) is higher than that of the currently
+		 running task (P), then the unblocked task (B) preempts the currently running task (A),
+		 and the preempted task (A) is added to the back of the ready queue. Otherwise B is added
+		 to the back of the ready queue. */
+		return insertNodePreempt(receiver);
 	}
 
-    if (prevState == BLK_MSG) {
-		// PREEMPTION CONDITIONS
-		TCB *A = gp_current_task;	// Currently running task
-		TCB *B = receiver;			// Unblocked task
-		U8 P = A->prio;
-		U8 Q = B->prio;
-		if (isQHigherPrioThanP(Q, P)) {
-			/*  if the priority of the unblocked task (Q) is higher than that
-			 of the currently running task (P), then the unblocked task (B) preempts the currently
-			 running task (A), and the preempted task (A) is added to the back of the ready queue. */
-
-			// DO NOT switch the order, we need readyQueue overwrite to execute first
-			if (replaceTopNode(B) != RTX_OK)
-				return RTX_ERR;
-			assignInsertionOrderToNode(B);
-
-			// note that here A should get a new insertionOrder, latest among all other tasks with same priority
-			updateMinInsertionOrder(A->insertionOrder);
-			insertNode(A);
-
-			// start executing immediately
-			if (switchToTask(B) != RTX_OK)
-				return RTX_ERR;
-		} else {
-			/* If the priority of the unblocked task (Q) is not higher than that of the currently
-			 running task (P), then the unblocked task (B) is added to the back of the ready queue. */
-
-			insertNode(B);
-		}
-	}
+    return RTX_OK;
+}
 
+/* k_send_msg from the kernel tick. A receiver it unblocks only goes into the ready queue,
+ * k_tsk_tick tells the interrupt handler if it has to run */
+int k_send_msg_tick(task_t receiver_tid, const void *buf) {
+    TCB *receiver = (receiver_tid < MAX_TASKS) ? g_tcbs[receiver_tid] : &g_tcb_dormant;
+    if (mbxDeliver(receiver, buf) != RTX_OK) {
+    	return RTX_ERR;
+    }
+    if (receiver->state == BLK_MSG) {
+		receiver->state = READY;
+		insertNode(receiver);
+	}
     return RTX_OK;
 }
 
@@ -144,13 +143,14 @@ int k_recv_msg(task_t *sender_tid, void *buf, size_t len) {
 //#endif /* DEBUG_0 */
 //    return 0;
 //}
-//
-//int k_mbx_ls(task_t *buf, int count) {
-//#ifdef DEBUG_0
-//    printf("k_mbx_ls: buf=0x%x, count=%d\r\n", buf, count);
-//#endif /* DEBUG_0 */
-//    return 0;
-//}
+
+/* tids of the tasks that are not DORMANT and have a mailbox, see k_tsk_ls_live() */
+int k_mbx_ls(task_t *buf, int count) {
+#ifdef DEBUG_0
+    printf("k_mbx_ls: buf=0x%x, count=%d\r\n", buf, count);
+#endif /* DEBUG_0 */
+    return k_tsk_ls_live(buf, count, TRUE);
+}
 
 int isMailBoxFull(TCB* tcb) {
 	return tcb -> mbSize == tcb->mbCapacity;
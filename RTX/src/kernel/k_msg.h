@@ -11,7 +11,9 @@
 #include "k_rtx.h"
 
 int k_mbx_create(size_t size);
+int k_mbx_create_tcb(TCB *p_tcb, size_t size);
 int k_send_msg(task_t receiver_tid, const void *buf);
+int k_send_msg_tick(task_t receiver_tid, const void *buf);
 int k_recv_msg(task_t *sender_tid, void *buf, size_t len);
 int k_recv_msg_nb(task_t *sender_tid, void *buf, size_t len);
 int k_mbx_ls(task_t *buf, int count);
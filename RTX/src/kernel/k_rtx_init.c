@@ -48,8 +48,8 @@ int k_rtx_init(RTX_TASK_INFO *task_info, int num_tasks)
 {
     // Initialize UART0 Rx interrupts
     UART0_Init();
-    // Set HPS0 timer to count down from
-    config_hps_timer(0,10000,1,1);
+    // Set HPS0 timer to interrupt once every kernel tick, it counts at 100 MHz
+    config_hps_timer(0,g_rtx_qtm * HPS_TIMER_PER_US,1,0);
     // Set A9 timer to count down from 0xFFFFFFFF every 1 us
     // With this setting, A9 timer resets every ~1.2 hrs
     config_a9_timer(0xFFFFFFFF,1,0,199);
@@ -70,13 +70,47 @@ int k_rtx_init(RTX_TASK_INFO *task_info, int num_tasks)
 
 int k_rtx_init_rt(RTX_SYS_INFO *sys_info, RTX_TASK_INFO *task_info, int num_tasks)
 {
-    /* initialize the scheduler here */
-    k_rtx_init(task_info, num_tasks);
-    return RTX_OK;
+    if (sys_info == NULL) {
+        return RTX_ERR;
+    }
+
+    // the kernel tick is a multiple of MIN_RTX_QTM, 0 gets the minimum
+    U32 qtm = (sys_info->rtx_time_qtm == 0) ? MIN_RTX_QTM : sys_info->rtx_time_qtm;
+    U8 sched = sys_info->sched;
+    if (qtm % MIN_RTX_QTM != 0 || (sched != DEFAULT && sched != EDF && sched != RM_PS && sched != RM_NPS)) {
+        return RTX_ERR;
+    }
+
+    /* the scheduler has to be set before the boot tasks go into the ready queue */
+    g_sched = sched;
+    g_rtx_qtm = qtm;
+    if (sched == RM_PS && k_tsk_server_init(&sys_info->server) != RTX_OK) {
+        g_sched = DEFAULT;
+        return RTX_ERR;
+    }
+    return k_rtx_init(task_info, num_tasks);
 }
 
 int k_get_sys_info(RTX_SYS_INFO *buffer)
 {
+    if (buffer == NULL) {
+        return RTX_ERR;
+    }
+    buffer->mem_split = k_mem_get_split();
+    buffer->sched = g_sched;
+    buffer->rtx_time_qtm = g_rtx_qtm;
+    buffer->server = g_ps_server;
+    return RTX_OK;
+}
+
+int k_get_time(TIMEVAL *tv)
+{
+    if (tv == NULL) {
+        return RTX_ERR;
+    }
+    U64 usec = (U64) g_rtx_ticks * g_rtx_qtm;
+    tv->sec = usec / 1000000;
+    tv->usec = usec % 1000000;
     return RTX_OK;
 }
 
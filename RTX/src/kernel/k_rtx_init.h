@@ -46,13 +46,18 @@
 #include "interrupt.h"
 #include "timer.h"
 
+#define HPS_TIMER_PER_US    100     /* HPS timer counts in one microsecond */
+
 /*
  *===========================================================================
  *                            FUNCTION PROTOTYPES
  *===========================================================================
  */
 
-int k_rtx_init  (RTX_TASK_INFO *task_info, int num_tasks);
+int k_rtx_init      (RTX_TASK_INFO *task_info, int num_tasks);
+int k_rtx_init_rt   (RTX_SYS_INFO *sys_info, RTX_TASK_INFO *task_info, int num_tasks);
+int k_get_sys_info  (RTX_SYS_INFO *buffer);
+int k_get_time      (TIMEVAL *tv);
 
 #endif /* ! K_RTX_INIT_H_ */
 
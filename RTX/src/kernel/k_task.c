@@ -52,6 +52,7 @@
 #include "Serial.h"
 #include "k_task.h"
 #include "k_rtx.h"
+#include "k_msg.h"
 
 #ifdef DEBUG_0
 #include "printf.h"
@@ -66,33 +67,130 @@
  */
 
 TCB             *gp_current_task = NULL;	// the current RUNNING task
-TCB             g_tcbs[MAX_TASKS];			// an array of TCBs
+TCB             *g_tcbs[MAX_TASKS];			// the TCB of every tid, &g_tcb_dormant when it has no task
+TCB             g_tcb_dormant;				// stands in for every TCB that does not exist, its state is DORMANT
+TCB             g_null_tcb;					// the null task is the only one with a static TCB
+TCB             *gp_dead_tcb = NULL;		// the task that exited last, its TCB and kernel stack are freed later, see k_tsk_exit
 RTX_TASK_INFO   g_null_task_info;			// The null task info
 U32             g_num_active_tasks = 0;		// number of non-dormant tasks, note g_num_active_tasks - 1 is the number of elements in ready queue
+U8              g_sched = DEFAULT;			// scheduler, k_rtx_init_rt sets it from RTX_SYS_INFO
+U32             g_rtx_qtm = MIN_RTX_QTM;	// length of a kernel tick in microseconds
+volatile U32    g_rtx_ticks = 0;			// kernel ticks since boot, counted by k_tsk_tick
+TCB             *gp_sleep_head = NULL;		// SUSPENDED tasks by wakeTick, the first one wakes up first
+TCB             *gp_deadline_head = NULL;	// real-time tasks with a job in progress, by deadline
+POLLING_SERVER  g_ps_server;				// the RM_PS polling server as configured, for k_get_sys_info
+U32             g_ps_period = 0;			// period of the RM_PS polling server in ticks
+U32             g_ps_capacity = 0;			// budget the server gets at the start of every period
+U32             g_ps_budget = 0;			// budget left in the current period
+U32             g_ps_release = 0;			// start of the current server period
+BOOL            g_ps_ran = FALSE;			// a task on the server budget ran during the current tick
+TCB             g_ps_tcb;					// the polling server's place in the admitted set, it never runs
+TCB             *gp_rt_set = NULL;			// admitted real-time tasks by period, see rtAdmit
+U64             g_rt_util = 0;				// EDF utilization of the admitted set rounded up, RT_UTIL_ONE is all of the CPU
+U64             g_rt_util_lo = 0;			// the same rounded down
 
 // below are declared by us
-// this is to track all the TIDs
-// 0 is reserved for NULL task
-// so when nextTidIndex == 0 our stack is actually empty
- task_t tids[MAX_TASKS];
- task_t nextTidIndex;
-
-/* this is a stable binary min heap
- * g_num_active_tasks is also used to mark the end of the heap in the array container
- *
- * we use an array of pointers that points to the actual TCB address in the OS img
- * for simplicity and not having to swap the entire struct of variables when we swap up and down
+/* free tids, bit (tid & 31) of g_tid_free[tid >> 5] is set while tid has no task.
+ * g_tid_sum has a bit for every word of g_tid_free that is not 0, and g_tid_top a bit
+ * for every word of g_tid_sum that is not 0, so the lowest free tid is three CLZ away.
+ * TID_NULL and TID_KCD are never set, they are not handed out by k_tsk_create
  * */
- TCB* readyQueue[MAX_TASKS];
-
-/* These variables are used to generate sequence used as insertion order into ready queue
- * curMinInsertionOrder represents the smallest insertion order in the ready queue
- * with this variable we can now make insertion order circular and avoid over flow
- * use unsigned short(U8) for full positive number range and smaller data size
- * because our MAX_TASKS is only around 160
+#define TID_WORDS   ((MAX_TASKS + 31) >> 5)
+#define TID_SUMS    ((TID_WORDS + 31) >> 5)
+
+#if TID_SUMS > 32
+#error "MAX_TASKS is too big for a three level tid bitmap"
+#endif
+
+ U32 g_tid_free[TID_WORDS];
+ U32 g_tid_sum[TID_SUMS];
+ U32 g_tid_top;
+
+/* the ready queue: one FIFO list per priority, linked through readyNext/readyPrev in the TCB,
+ * and a bitmap of the priorities whose list is not empty. bit (prio & 31) of g_ready_map[prio >> 5]
+ * is set while that list has a task, g_ready_sum has a bit for every word of g_ready_map that is not 0.
+ * The head of the highest priority list is the running task, the null task is never in the queue.
+ * The PRIO_RT list is kept in the order of the real-time scheduler instead, see rtBefore.
+ * g_num_active_tasks - 1 is the number of tasks in the queue
  * */
- task_t curMinInsertionOrder = 0;
- task_t nextAvailableOrder = 0;
+#define PRIO_LEVELS     256
+#define PRIO_WORDS      (PRIO_LEVELS >> 5)
+
+ TCB *g_ready_head[PRIO_LEVELS];
+ TCB *g_ready_tail[PRIO_LEVELS];
+ U32 g_ready_map[PRIO_WORDS];
+ U32 g_ready_sum;
+
+static U8 topPrio(void);
+static void unlinkNode(TCB *node);
+static void linkAfter(TCB *node, TCB *prev);
+static void insertNodeAtFront(TCB *node);
+static BOOL rtBefore(TCB *B, TCB *A);
+static U8 topPrioBelowRt(void);
+static BOOL serverRuns(void);
+static U32 tv_to_ticks(TIMEVAL *tv);
+static U32 tv_to_ticks_ceil(TIMEVAL *tv);
+static void ticks_to_tv(U32 ticks, TIMEVAL *tv);
+static void rtSetLink(TCB *p_tcb);
+static int rtAdmit(TCB *p_tcb);
+static void rtRetire(TCB *p_tcb);
+static int k_tsk_init_rt(TCB *p_tcb, RTX_TASK_INFO *p_taskinfo);
+static void k_tsk_free_stacks(TCB *p_tcb);
+static void k_tsk_init_frame(TCB *p_tcb, U32 entry);
+static void dlRemove(TCB *p_tcb);
+
+/* every tid is free except the reserved ones */
+static void tid_init(void) {
+	for (int w = 0; w < TID_WORDS; w++) {
+		g_tid_free[w] = 0xFFFFFFFF;
+	}
+	if ((MAX_TASKS & 31) != 0) {
+		g_tid_free[TID_WORDS - 1] = (1u << (MAX_TASKS & 31)) - 1;
+	}
+	g_tid_free[TID_NULL >> 5] &= ~(1u << (TID_NULL & 31));
+	g_tid_free[TID_KCD >> 5] &= ~(1u << (TID_KCD & 31));
+
+	g_tid_top = 0;
+	for (int s = 0; s < TID_SUMS; s++) {
+		g_tid_sum[s] = 0;
+	}
+	for (int w = 0; w < TID_WORDS; w++) {
+		if (g_tid_free[w] != 0) {
+			g_tid_sum[w >> 5] |= 1u << (w & 31);
+			g_tid_top |= 1u << (w >> 5);
+		}
+	}
+}
+
+/* takes the lowest free tid, TID_NULL when every tid has a task */
+static task_t tid_alloc(void) {
+	if (g_tid_top == 0) {
+		return TID_NULL;
+	}
+	U32 s = low_bit(g_tid_top);
+	U32 w = (s << 5) + low_bit(g_tid_sum[s]);
+	task_t tid = (w << 5) + low_bit(g_tid_free[w]);
+
+	g_tid_free[w] &= ~(1u << (tid & 31));
+	if (g_tid_free[w] == 0) {
+		g_tid_sum[s] &= ~(1u << (w & 31));
+		if (g_tid_sum[s] == 0) {
+			g_tid_top &= ~(1u << s);
+		}
+	}
+	return tid;
+}
+
+/* hands tid out again, the reserved ones stay reserved */
+static void tid_free(task_t tid) {
+	if (tid == TID_NULL || tid == TID_KCD || tid >= MAX_TASKS) {
+		return;
+	}
+	U32 w = tid >> 5;
+	g_tid_free[w] |= 1u << (tid & 31);
+	g_tid_sum[w >> 5] |= 1u << (w & 31);
+	g_tid_top |= 1u << (w >> 5);
+}
 
 
 /*---------------------------------------------------------------------------
@@ -124,21 +222,12 @@ The memory map of the OS image may look like the following:
                               |   other  global vars      |     |
                               |                           |  OS Image
                               |---------------------------|     |
-                              |      K_STACK_SIZE         |     |                
-             g_k_stacks[15]-->|---------------------------|     |
-                              |                           |     |
-                              |     other kernel stacks   |     |                              
-                              |---------------------------|     |
                               |      K_STACK_SIZE         |  OS Image
-              g_k_stacks[2]-->|---------------------------|     |
-                              |      K_STACK_SIZE         |     |                      
-              g_k_stacks[1]-->|---------------------------|     |
-                              |      K_STACK_SIZE         |     |
-              g_k_stacks[0]-->|---------------------------|     |
+             g_k_boot_stack-->|---------------------------|     |
                               |   other  global vars      |     |
                               |---------------------------|     |
                               |        TCBs               |  OS Image
-                      g_tcbs->|---------------------------|     |
+                  g_null_tcb->|---------------------------|     |
                               |        global vars        |     |
                               |---------------------------|     |
                               |                           |     |          
@@ -165,16 +254,70 @@ The memory map of the OS image may look like the following:
 
 TCB *scheduler(void)
 {
-    /* remember, don't remove the first prioity task from the min heap until it is finished
+    /* remember, don't remove the first prioity task from the ready queue until it is finished
      * because if we remove it right away and the job gets preempted,
-     * we would have to add it back and bubble up again
+     * we would have to add it back to the front of its list
      */
 
 	if (READY_QUEUE_SIZE <= 0) {
-	    return &g_tcbs[0];
+	    return g_tcbs[TID_NULL];
+	}
+	U8 prio = topPrio();
+	if (g_sched != RM_PS) {
+		return g_ready_head[prio];
+	}
+
+	// with a polling server the other tasks only run on its budget, see serverRuns
+	U8 other = topPrioBelowRt();
+	if (!serverRuns() || other == PRIO_NULL) {
+		if (prio == PRIO_RT) {
+			return g_ready_head[PRIO_RT];
+		}
+		// demoted jobs run in the background, where the null task would
+		return (g_ready_head[PRIO_BG] != NULL) ? g_ready_head[PRIO_BG] : g_tcbs[TID_NULL];
+	}
+	return g_ready_head[other];
+
+}
+
+/* frees the TCB and kernel stack of the task that exited last, it has been switched out by now */
+static void k_tsk_free_dead(void)
+{
+	if (gp_dead_tcb != NULL) {
+		k_dealloc_k_stack((U32*) gp_dead_tcb -> k_stack_hi, gp_dead_tcb -> k_stack_size);
+		k_slab_dealloc(gp_dead_tcb, sizeof(TCB));
+		gp_dead_tcb = NULL;
 	}
-	return readyQueue[0];
+}
+
+/**************************************************************************//**
+ * @brief       give tid a new, zeroed TCB from the slab
+ * @return      the TCB, NULL if there is no memory for it
+ *****************************************************************************/
+TCB *k_tsk_alloc_tcb(task_t tid)
+{
+	k_tsk_free_dead();
 
+	TCB *p_tcb = k_slab_alloc(sizeof(TCB));
+	if (p_tcb == NULL) {
+		return NULL;
+	}
+	for (U32 i = 0; i < sizeof(TCB) / 4; i++) {
+		((U32*) p_tcb)[i] = 0;
+	}
+	g_tcbs[tid] = p_tcb;
+	return p_tcb;
+}
+
+/**************************************************************************//**
+ * @brief       undo k_tsk_alloc_tcb for a task that never ran
+ *****************************************************************************/
+void k_tsk_free_tcb(task_t tid)
+{
+	if (g_tcbs[tid] != &g_tcb_dormant) {
+		k_slab_dealloc(g_tcbs[tid], sizeof(TCB));
+		g_tcbs[tid] = &g_tcb_dormant;
+	}
 }
 
 
@@ -205,48 +348,26 @@ int k_tsk_init(RTX_TASK_INFO *task_info, int num_tasks) {
 
 	// create the first task, which is the NULL task
 	// null task doesn't need a mail box so no mailbox related fields initialization
-	TCB *p_tcb = &g_tcbs[0];
+	TCB *p_tcb = &g_null_tcb;
+	g_tcbs[TID_NULL] = p_tcb;
 	p_tcb->prio = PRIO_NULL;
 	p_tcb->priv = 1;
 	p_tcb->tid = TID_NULL;
 	p_tcb->state = RUNNING;
+	p_tcb->k_stack_hi = (U32) (g_k_boot_stack + (K_STACK_SIZE >> 2)); // see startup_a9.s
+	p_tcb->k_stack_size = K_STACK_SIZE;
 	g_num_active_tasks++;
 	gp_current_task = p_tcb;
 
-	/* init the stack that stores all available tids, put all the numbers into every slot
-	 suppose MAX_TASKS = 16
-	 number of available tids should be MAX_TASKS - 1 = 15, because 0 is reserved for null task
-	 tids[0] = 0
-	 tids[1] = 1
-	 ...
-	 tids[14] = 14
-	 tids[15] = 15
-
-	 This must be done before start creating the task*/
-	for (int i = 0; i < TID_KCD; i++) {
-		tids[i] = i;
-	}
-	if (MAX_TASKS <= TID_UART_IRQ) {
-		for (int i = TID_KCD + 1; i < MAX_TASKS; i++) {
-			tids[i - 1] = i;
-		}
-		nextTidIndex = MAX_TASKS - 2;
-	} else {
-		for (int i = TID_KCD + 1; i < TID_UART_IRQ; i++) {
-			tids[i - 1] = i;
-		}
-		for (int i = TID_UART_IRQ + 1; i < MAX_TASKS; i++) {
-			tids[i - 2] = i;
-		}
-		nextTidIndex = MAX_TASKS - 3;
-	}
+	// must be done before creating the tasks
+	tid_init();
 
-	/* set all the tcbs in the os image to dormant so when we can check if a tcb is valid
-	 * by referencing it with it's tid at the corresponding tcb
-	 * except null task tcb at index 0
+	/* every tid but the null task's starts out without a task, so we can check if a tcb is valid
+	 * by referencing it with its tid
 	 * */
+	g_tcb_dormant.state = DORMANT;
 	for(int i = 1 ; i < MAX_TASKS ; i++) {
-		g_tcbs[i].state = DORMANT;
+		g_tcbs[i] = &g_tcb_dormant;
 	}
 
 	// create the rest of the tasks
@@ -254,15 +375,23 @@ int k_tsk_init(RTX_TASK_INFO *task_info, int num_tasks) {
 	p_taskinfo = task_info;
 	for (int i = 0; i < num_tasks; i++) {
 		// TID_KCD reserved for kcd task
-		task_t usedTid = p_taskinfo -> ptask == kcd_task ? TID_KCD : tids[nextTidIndex];
-		TCB *p_tcb = &g_tcbs[usedTid];
-		if (k_tsk_create_new(p_taskinfo, p_tcb, usedTid) == RTX_OK) {
+		task_t usedTid = p_taskinfo -> ptask == kcd_task ? TID_KCD : tid_alloc();
+		TCB *p_tcb = (usedTid != TID_NULL) ? k_tsk_alloc_tcb(usedTid) : NULL;
+		BOOL created = p_tcb != NULL && k_tsk_create_new(p_taskinfo, p_tcb, usedTid) == RTX_OK;
+		if (created && p_taskinfo -> prio == PRIO_RT && k_tsk_init_rt(p_tcb, p_taskinfo) != RTX_OK) {
+			// real-time boot tasks need a valid period, same as k_tsk_create_rt
+			k_tsk_free_stacks(p_tcb);
+			created = FALSE;
+		}
+		if (created) {
 			// Don't increment number of active task here. Handle it when pushing node in heap
 			// g_num_active_tasks++;
-
-			// moving tids top of stack index is not handled in k_tsk_create_new
 			insertNode(p_tcb);
-	        nextTidIndex--;
+		} else if (usedTid != TID_NULL) {
+			if (p_tcb != NULL) {
+				k_tsk_free_tcb(usedTid);
+			}
+			tid_free(usedTid);
 		}
 
 		// note that pointer arithmetic depends on the size of its type
@@ -313,8 +442,6 @@ int k_tsk_create_new(RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid)
 	p_tcb -> mbCapacity = 0;
 	p_tcb -> mbSize = 0;
 
-    extern U32 SVC_RESTORE;
-
     U32 *sp;
 
     if (p_taskinfo == NULL || p_tcb == NULL)
@@ -332,12 +459,64 @@ int k_tsk_create_new(RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid)
      *         stacks grows down, stack base is at the high address
      * -------------------------------------------------------------*/
 
-    ///////sp = g_k_stacks[tid] + (K_STACK_SIZE >> 2) ;
-    sp = k_alloc_k_stack(tid);
+    // the size is up to the task, 0 gets the default
+    if (p_taskinfo -> k_stack_size == 0) {
+    	p_taskinfo -> k_stack_size = K_STACK_SIZE;
+    }
+    if (p_taskinfo -> k_stack_size < K_STACK_MIN) {
+    	return RTX_ERR;
+    }
+    p_tcb -> k_stack_size = p_taskinfo -> k_stack_size;
+
+    sp = k_alloc_k_stack(p_taskinfo -> k_stack_size);
+    if (sp == NULL) {
+    	return RTX_ERR;
+    }
+    k_stack_paint(sp - (PAD(p_taskinfo -> k_stack_size) >> 2), PAD(p_taskinfo -> k_stack_size));
 
     p_taskinfo -> k_stack_hi = (U32) sp;
     p_tcb -> k_stack_hi = (U32) sp;
 
+    if ( p_taskinfo->priv == 0 ) { // unprivileged task
+        //********************************************************************//
+        //*** allocate user stack from the user space, not implemented yet ***//
+        //********************************************************************//
+
+        // be careful that when NULL is casted to U32 it's 0s so we make the NULL check before casting it to U32
+        U8* userStackStartPtr = k_slab_alloc(p_taskinfo -> u_stack_size);
+        if (userStackStartPtr == NULL) {
+        	k_dealloc_k_stack((U32*) p_tcb -> k_stack_hi, p_tcb -> k_stack_size);
+            return RTX_ERR;
+        }
+
+        k_stack_paint((U32*) userStackStartPtr, PAD(p_taskinfo -> u_stack_size));
+
+        // the stack grows down, so it starts at the high end of the block
+        U32 userStackHi = (U32) userStackStartPtr + PAD(p_taskinfo -> u_stack_size);
+        p_taskinfo -> u_stack_hi = userStackHi;
+        p_tcb -> u_stack_hi = userStackHi;
+    } else {
+    	// set both to 0 to avoid confusion in debugging
+    	p_taskinfo -> u_stack_size = 0;
+    	p_tcb -> u_stack_size = 0;
+    }
+
+    k_tsk_init_frame(p_tcb, (U32) p_tcb -> ptask);
+    return RTX_OK;
+}
+
+/**************************************************************************//**
+ * @brief       fabricate the initial context of p_tcb on its kernel stack, so the
+ *              next switch to it starts the task at its entry point with empty stacks
+ * @note        k_tsk_create_new calls it for a new task, rtMiss to start a task over
+ *              after its job was aborted
+ *****************************************************************************/
+static void k_tsk_init_frame(TCB *p_tcb, U32 entry)
+{
+    extern U32 SVC_RESTORE;
+
+    U32 *sp = (U32*) p_tcb -> k_stack_hi;
+
     // 8B stack alignment adjustment
     if ((U32)sp & 0x04) {   // if sp not 8B aligned, then it must be 4B aligned
         sp--;               // adjust it to 8B aligned
@@ -358,37 +537,17 @@ int k_tsk_create_new(RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid)
     // if kernel task runs under SVC mode, then no need to create user context stack frame for SVC handler entering
     // since we never enter from SVC handler in this case
     // uSP: initial user stack
-    if ( p_taskinfo->priv == 0 ) { // unprivileged task
+    if ( p_tcb->priv == 0 ) { // unprivileged task
         // xPSR: Initial Processor State
         *(--sp) = INIT_CPSR_USER;
         // PC contains the entry point of the user/privileged task
-        *(--sp) = (U32) (p_taskinfo->ptask);
-
-        //********************************************************************//
-        //*** allocate user stack from the user space, not implemented yet ***//
-        //********************************************************************//
-
-        // be careful that when NULL is casted to U32 it's 0s so we make the NULL check before casting it to U32
-        U32* userStackStartPtr = k_alloc_p_stack(p_taskinfo -> u_stack_size);
-        if (userStackStartPtr == NULL) {
-            return RTX_ERR;
-        }
-
-        p_taskinfo -> u_stack_hi = (U32) userStackStartPtr;
-        p_tcb -> u_stack_hi = (U32) userStackStartPtr;
-
-        // not sure why they want to cast it to a U32
-        // cuz we're on 32 bit processor technically a pointer is a U32
-        *(--sp) = (U32) userStackStartPtr;
+        *(--sp) = entry;
+        *(--sp) = p_tcb->u_stack_hi;
 
         // uR12, uR11, ..., uR0
         for ( int j = 0; j < 13; j++ ) {
             *(--sp) = 0x0;
         }
-    } else {
-    	// set both to 0 to avoid confusion in debugging
-    	p_taskinfo -> u_stack_size = 0;
-    	p_tcb -> u_stack_size = 0;
     }
 
 
@@ -398,12 +557,12 @@ int k_tsk_create_new(RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid)
      *         14 registers listed in push order
      *         <kLR, kR0-kR12>
      * -------------------------------------------------------------*/
-    if ( p_taskinfo->priv == 0 ) {
+    if ( p_tcb->priv == 0 ) {
         // user thread LR: return to the SVC handler
         *(--sp) = (U32) (&SVC_RESTORE);
     } else {
         // kernel thread LR: return to the entry point of the task
-        *(--sp) = (U32) (p_taskinfo->ptask);
+        *(--sp) = entry;
     }
 
     // kernel stack R0 - R12, 13 registers
@@ -414,8 +573,6 @@ int k_tsk_create_new(RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid)
     // kernel stack CPSR
     *(--sp) = (U32) INIT_CPSR_SVC;
     p_tcb->ksp = sp;
-
-    return RTX_OK;
 }
 
 /**************************************************************************//**
@@ -482,6 +639,8 @@ int k_tsk_run_new(void)
         // if a to-be-switched-out task is in either dormant or BLK_MSG or SUSPENDED the state persist
         // else put it to ready
         p_tcb_old -> state = p_tcb_old -> state == RUNNING ? READY : p_tcb_old -> state;
+        // under RM_PS a task that is not real-time ran on the server budget, the tick is charged for it
+        g_ps_ran |= (p_tcb_old -> prio != PRIO_RT && p_tcb_old -> prio != PRIO_BG && p_tcb_old -> prio != PRIO_NULL);
     	k_tsk_switch(p_tcb_old);            // switch stacks
         }
     return RTX_OK;
@@ -502,55 +661,20 @@ int k_tsk_yield(void)
 		return k_tsk_run_new();
 	}
 
-	switch (READY_QUEUE_SIZE) {
-	case 0: {
+	// take the running task off the top and see who is best without it
+	// A continues running only if it is strictly higher than every other ready task,
+	// otherwise it goes to the back of its priority and the best ready task runs
+	TCB *A = gp_current_task;
+	if (popMinNode() != RTX_OK) {
 		// nothing in ready queue, should let null task run
 		return k_tsk_run_new();
 	}
-	case 1: {
-		// only readyQueue[0] has something and that task called yield
-		// no need to compare priority of anything and we should let it keep running
-		return k_tsk_run_new();
-	}
-	case 2: {
-		// there are 2 tasks in readyQueue[0] and readyQueue[1]
-		// one current running task and one other ready task
-		// compare current running task's priority to the ready task's
-
-		TCB *A = gp_current_task;
-		U8 P = A->prio;
-		U8 leftChildPrio = readyQueue[1]->prio;
-		if (!isQHigherPrioThanP(P, leftChildPrio)) {
-			popMinNode();
-			insertNode(A);
-			return k_tsk_run_new();
-		}
-
+	if (runsBefore(A, scheduler())) {
+		insertNodeAtFront(A);
 		return RTX_OK;
 	}
-	default: {
-		// there are more including 3 nodes in the ready queue, compare both nodes
-
-		TCB *A = gp_current_task;
-		U8 P = A->prio;
-		U8 leftChildPrio = readyQueue[1]->prio;
-		U8 rightChildPrio = readyQueue[1]->prio;
-
-		if (!(isQHigherPrioThanP(P,leftChildPrio) && isQHigherPrioThanP(P, rightChildPrio))) {
-			/*	Otherwise, the highest-priority task in the ready queue starts running, and
-			 *  A is added to the back of the ready queue
-			 */
-
-			popMinNode();
-			insertNode(A);
-			return k_tsk_run_new();
-		}
-		/* A continues running only if Q is strictly higher than the priority of the
-		 * highest-priority task in the ready queue.
-		 */
-		return RTX_OK;
-	}
-	}
+	insertNode(A);
+	return k_tsk_run_new();
 }
 
 /*
@@ -567,22 +691,24 @@ int k_tsk_create(task_t *task, void (*task_entry)(void), U8 prio, U16 stack_size
 #endif /* DEBUG_0 */
 
     // May be more failure cases
-    if(nextTidIndex <= 0
-    		|| stack_size < U_STACK_SIZE
+    if(stack_size < U_STACK_SIZE
 			|| prio == PRIO_NULL
+			|| prio == PRIO_BG
 			|| prio == PRIO_RT
 			|| task == NULL
 			|| task_entry == NULL
 			|| (stack_size % 8) != 0
 			) {
-    	// no more available tids, meaning we have hit the max amount of tasks
     	// requested stack size is less than U_STACK_SIZE which is the minimum
-    	// invalid priority values
+    	// invalid priority values, PRIO_RT, PRIO_BG and PRIO_NULL are kernel only
     	return RTX_ERR;
     }
 
-	*task = tids[nextTidIndex];
-	nextTidIndex--;
+	*task = tid_alloc();
+	if (*task == TID_NULL) {
+		// no more available tids, meaning we have hit the max amount of tasks
+		return RTX_ERR;
+	}
 
 	RTX_TASK_INFO taskInfo;
 	// k_stack_hi and u_stack_hi is initialized in k_tsk_create_new
@@ -597,40 +723,17 @@ int k_tsk_create(task_t *task, void (*task_entry)(void), U8 prio, U16 stack_size
 	taskInfo.state = READY;
 	taskInfo.priv = 0;
 
-	if(k_tsk_create_new(&taskInfo, &g_tcbs[*task], *task) != RTX_OK) {
+	TCB *B = k_tsk_alloc_tcb(*task);
+	if(B == NULL || k_tsk_create_new(&taskInfo, B, *task) != RTX_OK) {
 		// possibility that the requested is too big and k_mem_alloc returns error
+		k_tsk_free_tcb(*task);
+		tid_free(*task);
 		return RTX_ERR;
 	}
 
-	// task creation logic for preemption, written in variables like in the lab manual
-	TCB *A = gp_current_task;
-	TCB *B = &g_tcbs[*task];
-	U8 P = A->prio;
-	U8 Q = B->prio;
-
-	if (isQHigherPrioThanP(Q, P)) {
-		//	If Q > P, then B preempts A(current task) and starts running immediately. In this case,
-		//	A is added to the back of the ready queue (i.e., A will be sorted as the last
-		//	task among all tasks with priority P)
-
-		// DO NOT switch the order, we need readyQueue overwrite to execute first
-		if (replaceTopNode(B) != RTX_OK) return RTX_ERR;
-		assignInsertionOrderToNode(B);
-
-		// note that here A should get a new insertionOrder, latest among all other tasks with same priority
-		updateMinInsertionOrder(A -> insertionOrder);
-		insertNode(A);
-
-		// start executing immediately
-		if (switchToTask(B) != RTX_OK) return RTX_ERR;
-	} else {
-		//	If Q <= P, then B is added to the back of the ready queue. (i.e., B will be
-		//	sorted as the last task among all tasks with priority Q)
-
-		insertNode(B);
-	}
-
-    return RTX_OK;
+	//	If Q > P, then B preempts A(current task) and starts running immediately, A is added
+	//	to the back of the ready queue. If Q <= P, then B is added to the back of the ready queue.
+	return insertNodePreempt(B);
 
 }
 
@@ -644,18 +747,33 @@ void k_tsk_exit(void)
 
     gp_current_task -> state = DORMANT;
 
+    if (gp_current_task -> rtPeriod != 0) {
+    	// its share of the CPU is free for the next real-time task
+    	rtRetire(gp_current_task);
+    	dlRemove(gp_current_task);
+    }
+
     if (gp_current_task -> priv == 0) {
-		// deallocate stack memory
-    	k_dealloc_p_stack((void*)gp_current_task->u_stack_hi);
+		// return the stack to its slab, the block starts u_stack_size below the top
+    	k_slab_dealloc((void*)(gp_current_task->u_stack_hi - PAD(gp_current_task->u_stack_size)), gp_current_task->u_stack_size);
     }
 
     // Need to deallocate mailbox if it exists
     if(gp_current_task->mbCapacity != 0)
     {
-    	k_dealloc_p_stack(gp_current_task->mailbox);
+    	k_slab_dealloc(gp_current_task->mailbox, gp_current_task->mbCapacity);
     }
 
-    tids[++nextTidIndex] = gp_current_task -> tid;
+    // everything else the task allocated and never freed goes back to the heap too
+    k_mem_reclaim(gp_current_task -> tid);
+
+    tid_free(gp_current_task -> tid);
+
+    // the switch below still runs on our kernel stack and saves our ksp into the TCB,
+    // so both are freed by the next exit or create
+    k_tsk_free_dead();
+    gp_dead_tcb = gp_current_task;
+    g_tcbs[gp_current_task -> tid] = &g_tcb_dormant;
 
     popMinNode();
     k_tsk_run_new();
@@ -669,110 +787,87 @@ int k_tsk_set_prio(task_t task_id, U8 prio)
     printf("task_id = %d, prio = %d.\n\r", task_id, prio);
 #endif /* DEBUG_0 */
 
-    if (prio == PRIO_NULL || prio == PRIO_RT || task_id >= MAX_TASKS || task_id <= 0 || g_tcbs[task_id].state == DORMANT  ) {
-    	//invalid priority values
+    if (prio == PRIO_NULL || prio == PRIO_BG || prio == PRIO_RT || task_id >= MAX_TASKS || task_id <= 0 || g_tcbs[task_id]->state == DORMANT  ) {
+    	//invalid priority values, PRIO_RT, PRIO_BG and PRIO_NULL are kernel only
 	   return RTX_ERR;
     }
+    if (g_tcbs[task_id] -> rtPeriod != 0) {
+    	// a real-time task keeps PRIO_RT, its place is decided by the scheduler
+    	return RTX_ERR;
+    }
 
-    TCB* targetTcb = &g_tcbs[task_id];
+    TCB* targetTcb = g_tcbs[task_id];
     U32 curTskId = k_tsk_get_tid();
 
     if (curTskId != task_id) {
     	// changing someone else's priority
 
 		// logic for checking if a priority change is allowed based on task privilege level
-		if (g_tcbs[curTskId].priv == 1) {
-			// kernel task can change priority of any other tasks
-			targetTcb -> prio = prio;
-		} else {
-			if (targetTcb -> priv == 1) {
-				// user task can't change priority of kernel task
-				return RTX_ERR;
-			}
-			targetTcb -> prio = prio;
+		// kernel task can change priority of any other tasks, user task can't change priority of kernel task
+		if (g_tcbs[curTskId]->priv == 0 && targetTcb -> priv == 1) {
+			return RTX_ERR;
 		}
 
 		// Priority change rule I
-		TCB *A = gp_current_task; // this is the same as readyQueue[0]
 		TCB *B = targetTcb;
-		if (targetTcb -> state == BLK_MSG || targetTcb->state == SUSPENDED) return RTX_OK;
-		U8 P = A -> prio;
-		U8 Q = prio;
-		if (isQHigherPrioThanP(Q, P)) {
-			/* If Q > P, then B preempts A, and A is added to the back of the ready queue.
-			 * note that here A is at the top of the ready queue
-			 * */
-
-			// DO NOT switch the order of the next following functions, we need readyQueue overwrite to execute first
-			// note B does not get a new insertion order
-			int indexOfB = getIndex(B);
-			if (indexOfB == -1) return RTX_ERR;
-			if (replaceTopNode(B) != RTX_OK || removeElement(indexOfB) != RTX_OK) return RTX_ERR;
-
-			// ask TA if A gets a new insertion order, assume it does
-			// should update min insertion order since we essentially popped a node and readded
-			updateMinInsertionOrder(A -> insertionOrder);
-			insertNode(A);
-
-			// start executing immediately
-			if (switchToTask(B) != RTX_OK) return RTX_ERR;
-		} else {
-			/* If Q <= P, then B is added to the back of the ready queue (even if Q is equal
-			 * to B's current priority).
-			 */
-
-			insertNode(B);
+		if (B -> state == BLK_MSG || B->state == SUSPENDED) {
+			B -> prio = prio;
+			return RTX_OK;
 		}
+		// B is READY, it moves to the list of its new priority
+		if (removeElement(B) != RTX_OK) return RTX_ERR;
+		B -> prio = prio;
+		/* If Q > P, then B preempts A, and A is added to the back of the ready queue.
+		 * If Q <= P, then B is added to the back of the ready queue (even if Q is equal
+		 * to B's current priority).
+		 */
+		return insertNodePreempt(B);
     } else {
     	// changing own priority
     	// no need to check if priority change is allowed based on privilege level cuz it's always allowed
 
         // Priority change rule II
+    	// A keeps running only if Q is strictly higher than every ready task, otherwise it goes to
+    	// the back of its new priority and the best ready task runs
     	TCB* A = targetTcb;
     	U8 Q = prio;
-    	targetTcb -> prio = Q;
-
-    	switch(READY_QUEUE_SIZE) {
-    	case 0: break;
-    	case 1: break;
-    	case 2: {
-        	TCB* leftChild = readyQueue[1];
-        	if (!isQHigherPrioThanP(Q, leftChild -> prio)) {
-        		popMinNode();
-        		insertNode(A);
-        		k_tsk_run_new();
-        	}
-        	break;
-    	}
-    	default: {
-    		TCB* leftChild = readyQueue[1];
-    		TCB* rightChild = readyQueue[2];
-    		if (!(isQHigherPrioThanP(Q, leftChild -> prio) && isQHigherPrioThanP(Q, rightChild -> prio))) {
-    			popMinNode();
-    			insertNode(A);
-        		k_tsk_run_new();
-    		}
-    		break;
-    	}
+    	popMinNode();
+    	A -> prio = Q;
+    	if (runsBefore(A, scheduler())) {
+    		insertNodeAtFront(A);
+    	} else {
+    		insertNode(A);
+    		k_tsk_run_new();
     	}
     }
 
     return RTX_OK;    
 }
 
+/*
+ * how deep the stacks of a task have ever been, in bytes.
+ * stacks are painted when the task is created (not the null task, it runs on the boot stack)
+ */
+static void k_tsk_stack_use(TCB *p_tcb, U16 *k_used, U16 *u_used)
+{
+	*k_used = k_stack_used((U32*) (p_tcb->k_stack_hi - PAD(p_tcb->k_stack_size)), PAD(p_tcb->k_stack_size));
+	*u_used = (p_tcb->u_stack_size == 0) ? 0 :
+			k_stack_used((U32*) (p_tcb->u_stack_hi - PAD(p_tcb->u_stack_size)), PAD(p_tcb->u_stack_size));
+}
+
 int k_tsk_get_info(task_t task_id, RTX_TASK_INFO *buffer)
 {
 #ifdef DEBUG_0
     printf("k_tsk_get_info: entering...\n\r");
     printf("task_id = %d, buffer = 0x%x.\n\r", task_id, buffer);
 #endif /* DEBUG_0 */    
-	if (buffer == NULL || g_tcbs[task_id].state == DORMANT) {
+	if (buffer == NULL || task_id >= MAX_TASKS || g_tcbs[task_id]->state == DORMANT) {
 		// task with task id of <task_id> does not exist
 		return RTX_ERR;
 	}
 
     // put all info in tcb into task info
-    TCB targetTcb = g_tcbs[task_id];
+    TCB targetTcb = *g_tcbs[task_id];
 
     buffer->tid = task_id;
     buffer->prio = targetTcb.prio;
@@ -783,10 +878,23 @@ int k_tsk_get_info(task_t task_id, RTX_TASK_INFO *buffer)
     buffer->u_stack_hi = targetTcb.u_stack_hi;
     buffer->k_stack_size = targetTcb.k_stack_size;
     buffer->u_stack_size = targetTcb.u_stack_size;
+    k_tsk_stack_use(g_tcbs[task_id], &buffer->k_stack_used, &buffer->u_stack_used);
+    ticks_to_tv(targetTcb.rtPeriod, &buffer->p_n);
+    ticks_to_tv(targetTcb.rtWcet, &buffer->c_n);
+    buffer->rt_mbx_size = (targetTcb.rtPeriod != 0) ? targetTcb.mbCapacity : 0;
 
     return RTX_OK;     
 }
 
+int k_tsk_get_stack_use(task_t task_id, U16 *k_used, U16 *u_used)
+{
+	if (task_id >= MAX_TASKS || g_tcbs[task_id]->state == DORMANT || k_used == NULL || u_used == NULL) {
+		return RTX_ERR;
+	}
+	k_tsk_stack_use(g_tcbs[task_id], k_used, u_used);
+	return RTX_OK;
+}
+
 task_t k_tsk_get_tid(void)
 {
 #ifdef DEBUG_0
@@ -799,268 +907,806 @@ int k_tsk_ls(task_t *buf, int count){
 #ifdef DEBUG_0
     printf("k_tsk_ls: buf=0x%x, count=%d\r\n", buf, count);
 #endif /* DEBUG_0 */
-    return 0;
+    return k_tsk_ls_live(buf, count, FALSE);
 }
 
-/* following helper functions are for the binary stable min heap
- * Current Node	readyQueue[i]
- * Parent Node	readyQueue[(i-1)/2]
- * Left Child	readyQueue[(2*i) + 1]
- * Right Child	readyQueue[(2*i )+ 2]
+/*
+ * fills buf with up to count tids of tasks that are not DORMANT, lowest first,
+ * only the ones with a mailbox if mbx_only is set. Returns how many it wrote.
+ * Whole words of free tids are skipped, so this is O(MAX_TASKS / 32) plus the tasks found.
  */
-int getParentIndex(int index) {
-	return (index - 1)/2;
+int k_tsk_ls_live(task_t *buf, int count, BOOL mbx_only) {
+	if (buf == NULL || count <= 0) {
+		return RTX_ERR;
+	}
+
+	int found = 0;
+	for (U32 w = 0; w < TID_WORDS && found < count; w++) {
+		U32 used = ~g_tid_free[w];
+		if (w == TID_WORDS - 1 && (MAX_TASKS & 31) != 0) {
+			used &= (1u << (MAX_TASKS & 31)) - 1;
+		}
+		while (used != 0 && found < count) {
+			task_t tid = (w << 5) + low_bit(used);
+			used &= used - 1;
+			// reserved tids have no bit either, they only count when their task exists
+			TCB *p_tcb = g_tcbs[tid];
+			if (p_tcb->state != DORMANT && (!mbx_only || p_tcb->mbCapacity != 0)) {
+				buf[found++] = tid;
+			}
+		}
+	}
+	return found;
 }
 
-int getLeftChildIndex(int index) {
-    return (index*2 + 1);
+/* following helper functions are for the ready queue, all of them are O(1) but insertNode of a real-time task
+ * a task is in the list of the priority it had when it was inserted, so take it out
+ * before changing its priority
+ */
+
+/* highest priority with a ready task, the queue must not be empty */
+static U8 topPrio(void) {
+	U32 w = low_bit(g_ready_sum);
+	return (w << 5) + low_bit(g_ready_map[w]);
 }
 
-int getRightChildIndex(int index) {
-    return (index*2 + 2);
+/* highest priority with a ready task that is not real-time, PRIO_NULL if there is none.
+ * Demoted jobs at PRIO_BG do not count, they are not work for the polling server */
+static U8 topPrioBelowRt(void) {
+	U32 first = g_ready_map[0] & ~(1u << PRIO_RT);
+	if (first != 0) {
+		return low_bit(first);
+	}
+	U32 sum = g_ready_sum & ~1u;
+	if (sum == 0) {
+		return PRIO_NULL;
+	}
+	U32 w = low_bit(sum);
+	U8 prio = (w << 5) + low_bit(g_ready_map[w]);
+	return (prio == PRIO_BG) ? PRIO_NULL : prio;
 }
 
-int replaceTopNode(TCB *node) {
-	/* CAUSTION: this is hard overwriting the ready queue
-	 * please only do this if you know what your doing
-	 * in this case the highest priority task should be B
-	 * so we should be ok to overwrite the top of the ready queue
-	 *
-	 * note that this function is not a proper heap function so
-	 * does not handle assigning insertion order
-	 * should call separately
-	 */
-	TCB* curTask = gp_current_task;
-	if (curTask -> prio <= node -> prio) {
-		// even cur task and new task has the same priority
-		// the new task would still have a later insertionOrder than old task
-		// so we should not allow overwrite
-		return RTX_ERR;
+/* take node out of its priority list, clearing the bitmap bits when the list runs empty */
+static void unlinkNode(TCB *node) {
+	U8 prio = node -> prio;
+	if (node -> readyPrev != NULL) {
+		node -> readyPrev -> readyNext = node -> readyNext;
+	} else {
+		g_ready_head[prio] = node -> readyNext;
+	}
+	if (node -> readyNext != NULL) {
+		node -> readyNext -> readyPrev = node -> readyPrev;
+	} else {
+		g_ready_tail[prio] = node -> readyPrev;
+	}
+	if (g_ready_head[prio] == NULL) {
+		g_ready_map[prio >> 5] &= ~(1u << (prio & 31));
+		if (g_ready_map[prio >> 5] == 0) {
+			g_ready_sum &= ~(1u << (prio >> 5));
+		}
 	}
-	readyQueue[0] = node;
-	readyQueue[0] -> indexInReadyQueue = 0;
+	g_num_active_tasks--;
+}
 
-	return RTX_OK;
+/* put node in the list of its priority right after prev, at the front if prev is NULL */
+static void linkAfter(TCB *node, TCB *prev) {
+	U8 prio = node -> prio;
+	TCB *next = (prev != NULL) ? prev -> readyNext : g_ready_head[prio];
+	node -> readyPrev = prev;
+	node -> readyNext = next;
+	if (prev != NULL) {
+		prev -> readyNext = node;
+	} else {
+		g_ready_head[prio] = node;
+	}
+	if (next != NULL) {
+		next -> readyPrev = node;
+	} else {
+		g_ready_tail[prio] = node;
+	}
+	g_ready_map[prio >> 5] |= 1u << (prio & 31);
+	g_ready_sum |= 1u << (prio >> 5);
+	g_num_active_tasks++;
 }
 
-void assignInsertionOrderToNode(TCB *node) {
-	node -> insertionOrder = nextInsertionOrder();
+/* put node in front of the tasks of its priority, so it is the top if nothing has a higher one */
+static void insertNodeAtFront(TCB *node) {
+	linkAfter(node, NULL);
 }
 
+/* node goes to the back of the tasks with its priority.
+ * Real-time tasks go behind the last task that does not come after them by rtBefore,
+ * that walks the PRIO_RT list so it is O(number of ready real-time tasks)
+ */
 int insertNode(TCB *node) {
-	if (READY_QUEUE_SIZE >= MAX_TASKS - 1) {
-		// queue is full, can't insert no more
-		// MAST_TASKS - 1 because of null task
+	if (node == NULL || node -> prio == PRIO_NULL) {
+		// the null task is never in the ready queue
 		return RTX_ERR;
 	}
 
-	assignInsertionOrderToNode(node);
-	readyQueue[READY_QUEUE_SIZE] = node;
-	readyQueue[READY_QUEUE_SIZE] -> indexInReadyQueue = READY_QUEUE_SIZE;
-
-	int curIndex = READY_QUEUE_SIZE;
-
-	// note we compare insertion order if priority is the same
-	while ( curIndex > 0 && hasGreaterPrioity(readyQueue[curIndex], readyQueue[getParentIndex(curIndex)])) {
-	        // Swap with parent
-	        TCB* temp = readyQueue[getParentIndex(curIndex)];
-
-	        readyQueue[getParentIndex(curIndex)] = readyQueue[curIndex];
-	        readyQueue[getParentIndex(curIndex)] -> indexInReadyQueue = getParentIndex(curIndex);
-
-	        readyQueue[curIndex] = temp;
-	        readyQueue[curIndex] -> indexInReadyQueue = curIndex;
+	TCB *prev = g_ready_tail[node -> prio];
+	if (node -> prio == PRIO_RT) {
+		while (prev != NULL && rtBefore(node, prev)) {
+			prev = prev -> readyPrev;
+		}
+	}
+	linkAfter(node, prev);
+	return RTX_OK;
+}
 
-	        // Update the current index of element
-	        curIndex = getParentIndex(curIndex);
-	    }
+int popMinNode() {
+    // This function removes the running task from the queue. it is the head of its list,
+    // but not the top when the polling server lets it run ahead of the real-time tasks
+    if ( READY_QUEUE_SIZE <= 0 || gp_current_task -> prio == PRIO_NULL ) {
+    	// note null task is always active
+    	// <= 0 means there is no tasks in ready queue
+    	return RTX_ERR;
+    }
+    unlinkNode(gp_current_task);
+    return RTX_OK;
+}
 
-	// update index
-	g_num_active_tasks++;
+/* B has just become READY. It goes into the queue, and if the scheduler now picks it over
+ * the running task A, A goes to the back of its priority and B runs
+ */
+int insertNodePreempt(TCB *B) {
+	TCB *A = gp_current_task;
+	insertNode(B);
+	if (scheduler() == A) {
+		return RTX_OK;
+	}
+	if (A -> prio != PRIO_NULL) {
+		unlinkNode(A);
+		insertNode(A);
+	}
+	return k_tsk_run_new();
+}
 
+/* take a READY task out of the queue wherever it is */
+int removeElement(TCB *node) {
+	if (node == NULL || READY_QUEUE_SIZE <= 0) {
+		// should not call this function when the queue is empty
+		return RTX_ERR;
+	}
+	unlinkNode(node);
 	return RTX_OK;
 }
 
-int hasGreaterPrioity(TCB* nodeA, TCB* nodeB) {
-	/* does task A have higher priority than task B
-	 * note that the smaller the number the higher the priority
-	 * also we compare insertion order if priority is the same
-	 * */
-	return ( nodeA -> prio < nodeB -> prio || ( nodeA -> prio == nodeB -> prio && isEarlier(nodeA -> insertionOrder, nodeB -> insertionOrder) ) );
+/* The below helper functions are preemption related
+ * */
+int isQHigherPrioThanP(U8 Q, U8 P)
+{
+	// Note that in the context of priority, the lower value has greater priority
+	return Q<P;
 }
 
-int popMinNode() {
-    // This function deletes the node with minimum priority at the top of the heap
-    if ( READY_QUEUE_SIZE <= 0 ) {
-    	// note null task is always active
-    	// <= 1 means there is no tasks in ready queue
-    	return RTX_ERR;
-    }
+/* B goes ahead of A in the ready queue: it has a higher priority, or both are real-time and B comes first */
+int runsBefore(TCB *B, TCB *A)
+{
+	return isQHigherPrioThanP(B -> prio, A -> prio)
+			|| (B -> prio == PRIO_RT && A -> prio == PRIO_RT && rtBefore(B, A));
+}
 
-    // swap root node with the last node
-    // last node removed by decreasing size by 1
-    TCB* toBePopped = readyQueue[0];
-    readyQueue[0] = readyQueue[READY_QUEUE_SIZE - 1];
-    readyQueue[0] -> indexInReadyQueue = 0;
+/* order of the real-time tasks: by absolute deadline under EDF, shortest period first under
+ * rate-monotonic, in order of release otherwise. tick counts wrap, so times are compared by their difference
+ */
+static BOOL rtBefore(TCB *B, TCB *A)
+{
+	if (g_sched == EDF) {
+		return (S32) (B -> rtDeadline - A -> rtDeadline) < 0;
+	}
+	if (g_sched == RM_PS || g_sched == RM_NPS) {
+		return B -> rtPeriod < A -> rtPeriod;
+	}
+	return FALSE;
+}
 
-    g_num_active_tasks --;
+/* under RM_PS the polling server is a periodic task with period g_ps_period. It lends its budget to the
+ * tasks that are not real-time, so they run while it has budget and no real-time task of shorter period is ready
+ */
+static BOOL serverRuns(void)
+{
+	TCB *rt = g_ready_head[PRIO_RT];
+	return g_ps_budget != 0 && (rt == NULL || g_ps_period < rt -> rtPeriod);
+}
 
-    if(heapify(0)!= RTX_OK) {
-    	return RTX_ERR;
-    }
+/*
+ *===========================================================================
+ *                             TO BE IMPLEMETED IN LAB4
+ *===========================================================================
+ */
 
-    updateMinInsertionOrder(toBePopped -> insertionOrder);
-    return RTX_OK;
+/*
+ * Real-time tasks run at PRIO_RT, ahead of every other task, so the rest of the system
+ * only gets the CPU while no job is ready, or on the budget of the polling server under RM_PS.
+ * A job is released every rtPeriod ticks, its deadline is the next release. The PRIO_RT list
+ * is kept by deadline under EDF and by period under RM_PS and RM_NPS, see rtBefore.
+ * Between jobs a task is SUSPENDED in the sleep list until k_tsk_tick releases it.
+ * A task is only created if the real-time set stays schedulable with it, see rtAdmit.
+ */
+
+/* tv in kernel ticks, 0 if it is not a positive whole number of ticks */
+static U32 tv_to_ticks(TIMEVAL *tv)
+{
+	if (tv == NULL || tv -> usec >= 1000000) {
+		return 0;
+	}
+	U64 usec = (U64) tv -> sec * 1000000 + tv -> usec;
+	if (usec % g_rtx_qtm != 0 || usec / g_rtx_qtm >= 0x80000000u) {
+		// half the tick range at most, so the difference of two times still has the right sign
+		return 0;
+	}
+	return (U32) (usec / g_rtx_qtm);
 }
 
-int removeElement(int index) {
-	if (index < 0 || READY_QUEUE_SIZE <= 0) {
-		// should not call this function when heap size is 0
-		return RTX_ERR;
+/* tv in kernel ticks rounded up, so a WCET is never underestimated. 0 if tv is 0 or out of range */
+static U32 tv_to_ticks_ceil(TIMEVAL *tv)
+{
+	if (tv == NULL || tv -> usec >= 1000000) {
+		return 0;
 	}
+	U64 ticks = ((U64) tv -> sec * 1000000 + tv -> usec + g_rtx_qtm - 1) / g_rtx_qtm;
+	return (ticks < 0x80000000u) ? (U32) ticks : 0;
+}
 
-	// swap with the last element
-	readyQueue[index] = readyQueue[READY_QUEUE_SIZE - 1];
-	readyQueue[index] -> indexInReadyQueue = index;
+static void ticks_to_tv(U32 ticks, TIMEVAL *tv)
+{
+	U64 usec = (U64) ticks * g_rtx_qtm;
+	tv -> sec = usec / 1000000;
+	tv -> usec = usec % 1000000;
+}
 
-	g_num_active_tasks--;
-	heapify(index);
-	// purposely not call updateMinInsertionOrder here cuz the requirement for set_prio.
-	// after replacedTop the node should not get a new insertion order
-	return RTX_OK;
+/*
+ * Admission control. gp_rt_set holds every real-time task, and the polling server under RM_PS,
+ * ordered by period. A new task only gets in if every deadline can still be met:
+ * EDF meets them all as long as the utilization, the sum of rtWcet / rtPeriod, is at most 1.
+ * g_rt_util keeps that sum in 32.32 fixed point with every share rounded up, g_rt_util_lo with
+ * every share rounded down. Only when they fall on both sides of 1 is the exact sum worked out.
+ * RM uses response-time analysis. A job of task i is done at the latest after
+ *     R = C_i + sum over the tasks j that can preempt it of ceil(R / T_j) * C_j
+ * which is found by iterating from R = C_i, and it has to be done within its period.
+ * A new task k only delays the tasks that it can preempt, and each of them by C_k at least,
+ * so only those are redone and their iteration starts at their old R + C_k.
+ * DEFAULT runs the real-time tasks first come, first served, it admits every task.
+ */
+#define RT_UTIL_ONE     ((U64) 1 << 32)
+
+/* share of the CPU p_tcb needs, rounded up */
+static U64 rtUtil(TCB *p_tcb)
+{
+	return (((U64) p_tcb -> rtWcet << 32) + p_tcb -> rtPeriod - 1) / p_tcb -> rtPeriod;
 }
 
-int getIndex(TCB* tcbPtr) {
-    return tcbPtr -> indexInReadyQueue;
+static U64 rtUtilLo(TCB *p_tcb)
+{
+	return ((U64) p_tcb -> rtWcet << 32) / p_tcb -> rtPeriod;
 }
 
-int heapify(int curIndex) {
-	// this function only checks the cur node and everything under it
-	if (READY_QUEUE_SIZE <= 1) {
-		// were done if readyQueue has only one task in it
-        return RTX_OK;
+static U64 gcd(U64 a, U64 b)
+{
+	while (b != 0) {
+		U64 r = a % b;
+		a = b;
+		b = r;
 	}
+	return a;
+}
 
-	int leftIndex = getLeftChildIndex(curIndex);
-	int rightIndex = getRightChildIndex(curIndex);
+/* the exact utilization of the admitted set with p_tcb is at most 1. It is added up as a fraction
+ * over the lcm of the periods, a set whose lcm gets too big for that does not fit */
+static BOOL rtUtilFits(TCB *p_tcb)
+{
+	U64 num = p_tcb -> rtWcet;
+	U64 den = p_tcb -> rtPeriod;
+	for (TCB *q = gp_rt_set; q != NULL; q = q -> rtNext) {
+		U64 g = gcd(den, q -> rtPeriod);
+		U64 f = q -> rtPeriod / g;
+		if (den > (((U64) 1 << 63) - 1) / f) {
+			return FALSE;
+		}
+		num = num * f + q -> rtWcet * (den / g);
+		den *= f;
+		if (num > den) {
+			return FALSE;
+		}
+		g = gcd(num, den);
+		num /= g;
+		den /= g;
+	}
+	return TRUE;
+}
 
-	// in the next couple lines we find the smallest out of cur, left child and right child
-	// note that in binary min heap left child node is always smaller than right child node
-	// index of the smallest element, we first assume it to be the target node
-	int highestPrioityIndex = curIndex;
+/* Q can preempt a job of P under RM. Of two tasks with the same period the one released first
+ * runs first, so either can delay the other, but the server gives way to a task with its period */
+static BOOL rtInterferes(TCB *Q, TCB *P)
+{
+	return Q != P && (Q -> rtPeriod < P -> rtPeriod || (Q -> rtPeriod == P -> rtPeriod && Q != &g_ps_tcb));
+}
 
-	// compare left child with cur, also check if right child exist
-	if (leftIndex < READY_QUEUE_SIZE
-			&& hasGreaterPrioity(readyQueue[leftIndex], readyQueue[highestPrioityIndex])) {
-		highestPrioityIndex = leftIndex;
+/* worst-case response time of p_tcb under RM, r must not be above it. 0 if it is longer than the period */
+static U32 rtResponse(TCB *p_tcb, U32 r)
+{
+	while (r <= p_tcb -> rtPeriod) {
+		U64 demand = p_tcb -> rtWcet;
+		for (TCB *q = gp_rt_set; q != NULL && q -> rtPeriod <= p_tcb -> rtPeriod; q = q -> rtNext) {
+			if (rtInterferes(q, p_tcb)) {
+				demand += (U64) ((r + q -> rtPeriod - 1) / q -> rtPeriod) * q -> rtWcet;
+			}
+		}
+		if (demand == r) {
+			return r;
+		}
+		if (demand > p_tcb -> rtPeriod) {
+			break;
+		}
+		r = (U32) demand;
 	}
+	return 0;
+}
 
-	// compare right child with highestPrioity{leftChild, cur}, also check if right child exist
-	if (rightIndex < READY_QUEUE_SIZE
-			&& hasGreaterPrioity(readyQueue[rightIndex], readyQueue[highestPrioityIndex]))
-		highestPrioityIndex = rightIndex;
+/* p_tcb joins gp_rt_set behind the tasks with the same period */
+static void rtSetLink(TCB *p_tcb)
+{
+	TCB **link = &gp_rt_set;
+	while (*link != NULL && (*link) -> rtPeriod <= p_tcb -> rtPeriod) {
+		link = &(*link) -> rtNext;
+	}
+	p_tcb -> rtNext = *link;
+	*link = p_tcb;
+}
 
-	// if curIndex is not the highestPrioityIndex, swap them
-	// also do this recursively, with target node being the smallest
-	if (highestPrioityIndex != curIndex) {
-		TCB *temp = readyQueue[curIndex];
-		readyQueue[curIndex] = readyQueue[highestPrioityIndex];
-		readyQueue[curIndex] -> indexInReadyQueue = curIndex;
+static void rtSetUnlink(TCB *p_tcb)
+{
+	TCB **link = &gp_rt_set;
+	while (*link != p_tcb) {
+		link = &(*link) -> rtNext;
+	}
+	*link = p_tcb -> rtNext;
+}
 
-		readyQueue[highestPrioityIndex] = temp;
-		readyQueue[highestPrioityIndex] -> indexInReadyQueue = highestPrioityIndex;
+/* p_tcb joins the admitted set, RTX_ERR if that could make a job miss its deadline */
+static int rtAdmit(TCB *p_tcb)
+{
+	if (g_sched == EDF) {
+		if (g_rt_util_lo + rtUtilLo(p_tcb) > RT_UTIL_ONE
+				|| (g_rt_util + rtUtil(p_tcb) > RT_UTIL_ONE && !rtUtilFits(p_tcb))) {
+			return RTX_ERR;
+		}
+		g_rt_util += rtUtil(p_tcb);
+		g_rt_util_lo += rtUtilLo(p_tcb);
+		rtSetLink(p_tcb);
+		return RTX_OK;
+	}
 
-		// note that here we call heapify with highestPrioityIndex because we never updated it,
-		// it's still either left or right node
-		return heapify(highestPrioityIndex);
+	rtSetLink(p_tcb);
+	if (g_sched != RM_PS && g_sched != RM_NPS) {
+		return RTX_OK;
 	}
 
+	// the new response times go to rtTrial first, they only count if they all fit
+	BOOL ok = TRUE;
+	for (TCB *q = gp_rt_set; q != NULL && ok; q = q -> rtNext) {
+		if (q == p_tcb) {
+			q -> rtTrial = rtResponse(q, q -> rtWcet);
+			ok = q -> rtTrial != 0;
+		} else if (rtInterferes(p_tcb, q)) {
+			q -> rtTrial = rtResponse(q, q -> rtResponse + p_tcb -> rtWcet);
+			ok = q -> rtTrial != 0;
+		}
+	}
+	if (!ok) {
+		rtSetUnlink(p_tcb);
+		return RTX_ERR;
+	}
+	for (TCB *q = gp_rt_set; q != NULL; q = q -> rtNext) {
+		if (q == p_tcb || rtInterferes(p_tcb, q)) {
+			q -> rtResponse = q -> rtTrial;
+		}
+	}
 	return RTX_OK;
 }
 
-/*	below helper function are associated with insertion order
- * 	in order to make our binary min heap stable
- * */
-task_t nextInsertionOrder() {
-	task_t nextVal = nextAvailableOrder;
-	//  purposely let it overflow
-	nextAvailableOrder = nextAvailableOrder + 1;
-	return nextVal;
+/* p_tcb leaves the admitted set. The tasks it could preempt finish sooner now, their response
+ * times are redone from scratch since the old ones are too long to start from */
+static void rtRetire(TCB *p_tcb)
+{
+	rtSetUnlink(p_tcb);
+	if (g_sched == EDF) {
+		g_rt_util -= rtUtil(p_tcb);
+		g_rt_util_lo -= rtUtilLo(p_tcb);
+	} else if (g_sched == RM_PS || g_sched == RM_NPS) {
+		for (TCB *q = gp_rt_set; q != NULL; q = q -> rtNext) {
+			if (rtInterferes(p_tcb, q)) {
+				q -> rtResponse = rtResponse(q, q -> rtWcet);
+			}
+		}
+	}
 }
 
-void updateMinInsertionOrder(task_t order) {
-	// this function should be called whenever an task is exited
-	// and the insertion order is returned to be available for someone else
-	curMinInsertionOrder = order == curMinInsertionOrder ? curMinInsertionOrder + 1 : curMinInsertionOrder;
+/* gives back the stacks k_tsk_create_new allocated, for a task that never ran */
+static void k_tsk_free_stacks(TCB *p_tcb)
+{
+	if (p_tcb -> priv == 0) {
+		k_slab_dealloc((void*)(p_tcb->u_stack_hi - PAD(p_tcb->u_stack_size)), p_tcb->u_stack_size);
+	}
+	k_dealloc_k_stack((U32*) p_tcb -> k_stack_hi, p_tcb -> k_stack_size);
 }
 
-int isEarlier(task_t a, task_t b) {
-	// the smaller the number the earlier it's inserted
-	// so this function also means "is a smaller than b"
-	if ( curMinInsertionOrder > a && curMinInsertionOrder <= b) {
-		//real of a > real of b
-		return 0;
-	} else if ( curMinInsertionOrder > b && curMinInsertionOrder <= a ) {
-		// real of b > real of a
-		return 1;
-	} else {
-		return a < b;
+/* the job of p_tcb is in progress until k_tsk_done_rt, k_tsk_tick checks it against its deadline */
+static void dlInsert(TCB *p_tcb)
+{
+	TCB **link = &gp_deadline_head;
+	while (*link != NULL && (S32) ((*link) -> rtDeadline - p_tcb -> rtDeadline) <= 0) {
+		link = &(*link) -> dlNext;
 	}
+	p_tcb -> dlNext = *link;
+	*link = p_tcb;
 }
 
-/* The below helper functions are preemption related
- * */
-int isQHigherPrioThanP(U8 Q, U8 P)
+/* the job of p_tcb is over, nothing happens if it already missed its deadline */
+static void dlRemove(TCB *p_tcb)
 {
-	// Note that in the context of priority, the lower value has greater priority
-	return Q<P;
+	for (TCB **link = &gp_deadline_head; *link != NULL; link = &(*link) -> dlNext) {
+		if (*link == p_tcb) {
+			*link = p_tcb -> dlNext;
+			return;
+		}
+	}
 }
 
-int switchToTask(TCB* newTask) {
-	// essentially this is the same as k_tsk_run_new()
-	// but we can specify a task instead of poping from readyQueue
-	// USE WITH CAUTION AND UPDATE READYQUEUE ACCORDINGLY
-
-	if (gp_current_task == newTask || newTask == NULL) {
+/* makes p_tcb real-time with the period, WCET and mailbox in p_taskinfo, its first job is released now.
+ * RTX_ERR if they are not valid, there is no memory for the mailbox or the task is not admitted */
+static int k_tsk_init_rt(TCB *p_tcb, RTX_TASK_INFO *p_taskinfo)
+{
+	U32 period = tv_to_ticks(&p_taskinfo -> p_n);
+	U32 wcet = tv_to_ticks_ceil(&p_taskinfo -> c_n);
+	if (period == 0 || wcet == 0 || wcet > period) {
+		return RTX_ERR;
+	}
+	p_tcb -> rtPeriod = period;
+	p_tcb -> rtWcet = wcet;
+	if (rtAdmit(p_tcb) != RTX_OK) {
 		return RTX_ERR;
 	}
+	if (p_taskinfo -> rt_mbx_size != 0 && k_mbx_create_tcb(p_tcb, p_taskinfo -> rt_mbx_size) != RTX_OK) {
+		rtRetire(p_tcb);
+		return RTX_ERR;
+	}
+	p_tcb -> rtRelease = g_rtx_ticks;
+	p_tcb -> rtDeadline = g_rtx_ticks + period;
+	dlInsert(p_tcb);
+	return RTX_OK;
+}
 
-    TCB *p_tcb_old = NULL;
+/* the job of p_tcb that is released at tick release goes into the ready queue */
+static void rtJobRelease(TCB *p_tcb, U32 release)
+{
+	p_tcb -> rtRelease = release;
+	p_tcb -> rtDeadline = release + p_tcb -> rtPeriod;
+	insertNode(p_tcb);
+	dlInsert(p_tcb);
+}
 
-    p_tcb_old = gp_current_task;
-    gp_current_task = newTask;
+/* takes p_tcb out of the sleep list */
+static void sleepRemove(TCB *p_tcb)
+{
+	TCB **link = &gp_sleep_head;
+	while (*link != p_tcb) {
+		link = &(*link) -> sleepNext;
+	}
+	*link = p_tcb -> sleepNext;
+}
 
-	gp_current_task->state = RUNNING;   // change state of the to-be-switched-in  tcb
-	p_tcb_old->state = READY;           // change state of the to-be-switched-out tcb
-	k_tsk_switch(p_tcb_old);            // switch stacks
+/* tells the supervisor of p_tcb that its job missed a deadline, the message comes from p_tcb.
+ * It is lost if the supervisor has exited or its mailbox is full */
+static void rtNotify(TCB *p_tcb)
+{
+	struct {
+		RTX_MSG_HDR hdr;
+		RT_MISS_INFO info;
+	} msg;
+	msg.hdr.length = sizeof(msg);
+	msg.hdr.type = RT_MISS;
+	msg.info.tid = p_tcb -> tid;
+	msg.info.misses = p_tcb -> rtMisses;
+	ticks_to_tv(p_tcb -> rtDeadline, &msg.info.deadline);
+
+	task_t curTaskTid = gp_current_task -> tid;
+	gp_current_task -> tid = p_tcb -> tid;
+	k_send_msg_tick(p_tcb -> rtSupervisor, &msg);
+	gp_current_task -> tid = curTaskTid;
+}
 
-	return RTX_OK;
+/* the kernel half of rtRestart: the blocks of the aborted job go back to the heap here, in a system
+ * call of the new job, and not in the timer interrupt that aborted it. Returns the entry of the task */
+static U32 k_tsk_rt_restart(void)
+{
+	k_mem_reclaim(gp_current_task -> tid);
+	return (U32) gp_current_task -> ptask;
+}
+
+extern U32 _tsk_rt_restart(U32 p_func) __svc_indirect(0);
+
+/* a job dropped by MISS_ABORT starts over here, in user mode on a fresh user stack */
+static void rtRestart(void)
+{
+	void (*entry)(void) = (void (*)(void)) _tsk_rt_restart((U32) k_tsk_rt_restart);
+	entry();
 }
 
 /*
- *===========================================================================
- *                             TO BE IMPLEMETED IN LAB4
- *===========================================================================
+ * the job of p_tcb is still running at its deadline, k_tsk_tick has taken it out of the deadline list.
+ * The deadline is also the release of the next job, so under MISS_ABORT that one starts right away
  */
+static void rtMiss(TCB *p_tcb)
+{
+	BOOL queued = (p_tcb -> state == READY || p_tcb -> state == RUNNING);
+
+	p_tcb -> rtMisses++;
+	if (p_tcb -> rtPolicy & MISS_NOTIFY) {
+		rtNotify(p_tcb);
+	}
+
+	switch (p_tcb -> rtPolicy & ~MISS_NOTIFY) {
+	case MISS_ABORT:
+		if (queued) {
+			unlinkNode(p_tcb);
+		} else if (p_tcb -> state == SUSPENDED) {
+			// in k_tsk_suspend part way through the job
+			sleepRemove(p_tcb);
+		}
+		// the new job starts from scratch, so what the old one allocated is lost to it. rtRestart
+		// gives it back before the task runs again, freeing it here would walk the heap in the interrupt
+		if (p_tcb == gp_current_task) {
+			// we are on its kernel stack, the timer interrupt returns to rtRestart instead
+			irq_frame_restart(p_tcb -> k_stack_hi, (U32) rtRestart, p_tcb -> u_stack_hi);
+		} else {
+			k_tsk_init_frame(p_tcb, (U32) rtRestart);
+			p_tcb -> state = READY;
+		}
+		rtJobRelease(p_tcb, p_tcb -> rtDeadline);
+		break;
+	case MISS_DEMOTE:
+		// the job goes on behind every other task, k_tsk_done_rt brings the task back to PRIO_RT.
+		// Under RM_PS it stays off the polling server budget, see PRIO_BG
+		if (queued) {
+			unlinkNode(p_tcb);
+		}
+		p_tcb -> prio = (g_sched == RM_PS) ? PRIO_BG : LOWEST;
+		if (queued) {
+			insertNode(p_tcb);
+		}
+		break;
+	default:
+		// MISS_CONTINUE and MISS_SKIP, k_tsk_done_rt takes care of the releases it overran
+		break;
+	}
+}
+
+/* p_tcb sleeps until tick wake, behind the tasks that wake up at the same time */
+static void sleepInsert(TCB *p_tcb, U32 wake)
+{
+	TCB **link = &gp_sleep_head;
+	while (*link != NULL && (S32) ((*link) -> wakeTick - wake) <= 0) {
+		link = &(*link) -> sleepNext;
+	}
+	p_tcb -> wakeTick = wake;
+	p_tcb -> sleepNext = *link;
+	*link = p_tcb;
+}
 
 int k_tsk_create_rt(task_t *tid, TASK_RT *task)
 {
-    return 0;
+#ifdef DEBUG_0
+    printf("k_tsk_create_rt: tid = 0x%x, task = 0x%x\r\n", tid, task);
+#endif /* DEBUG_0 */
+
+	if (tid == NULL
+			|| task == NULL
+			|| task -> task_entry == NULL
+			|| task -> u_stack_size < U_STACK_SIZE
+			|| (task -> u_stack_size % 8) != 0
+			|| tv_to_ticks(&task -> p_n) == 0
+			) {
+		return RTX_ERR;
+	}
+
+	*tid = tid_alloc();
+	if (*tid == TID_NULL) {
+		return RTX_ERR;
+	}
+
+	RTX_TASK_INFO taskInfo;
+	taskInfo.ptask = task -> task_entry;
+	taskInfo.k_stack_size = K_STACK_SIZE;
+	taskInfo.u_stack_size = task -> u_stack_size;
+	taskInfo.tid = *tid;
+	taskInfo.prio = PRIO_RT;
+	taskInfo.state = READY;
+	taskInfo.priv = 0;
+	taskInfo.p_n = task -> p_n;
+	taskInfo.c_n = task -> c_n;
+	taskInfo.rt_mbx_size = task -> rt_mbx_size;
+
+	TCB *B = k_tsk_alloc_tcb(*tid);
+	if (B == NULL || k_tsk_create_new(&taskInfo, B, *tid) != RTX_OK) {
+		k_tsk_free_tcb(*tid);
+		tid_free(*tid);
+		return RTX_ERR;
+	}
+	if (k_tsk_init_rt(B, &taskInfo) != RTX_OK) {
+		// not schedulable, or no memory for the mailbox
+		k_tsk_free_stacks(B);
+		k_tsk_free_tcb(*tid);
+		tid_free(*tid);
+		return RTX_ERR;
+	}
+
+	// the first job is released now, it preempts the caller unless that one comes first
+	insertNode(B);
+	return k_tsk_run_new();
 }
 
 void k_tsk_done_rt(void) {
 #ifdef DEBUG_0
     printf("k_tsk_done: Entering\r\n");
 #endif /* DEBUG_0 */
-    return;
+	TCB *p_tcb = gp_current_task;
+	if (p_tcb -> rtPeriod == 0) {
+		// only real-time tasks have jobs
+		return;
+	}
+
+	// the job is done, the task waits for the release of the next one
+	popMinNode();
+	dlRemove(p_tcb);
+	p_tcb -> prio = PRIO_RT;        // after MISS_DEMOTE
+	p_tcb -> rtJobs++;
+	// it finished during the current tick, which counts in full
+	U32 response = g_rtx_ticks - p_tcb -> rtRelease + 1;
+	if (response > p_tcb -> rtWorst) {
+		p_tcb -> rtWorst = response;
+	}
+
+	U32 next = p_tcb -> rtRelease + p_tcb -> rtPeriod;
+	if ((S32) (next - g_rtx_ticks) <= 0 && (p_tcb -> rtPolicy & ~MISS_NOTIFY) == MISS_SKIP) {
+		// the releases it overran are dropped, the next job starts with the next period
+		next += ((g_rtx_ticks - next) / p_tcb -> rtPeriod + 1) * p_tcb -> rtPeriod;
+	}
+	if ((S32) (next - g_rtx_ticks) <= 0) {
+		// the job ran past its period, the next one is due already
+		rtJobRelease(p_tcb, next);
+	} else {
+		p_tcb -> state = SUSPENDED;
+		p_tcb -> sleepJob = TRUE;
+		sleepInsert(p_tcb, next);
+	}
+	k_tsk_run_new();
+}
+
+/*
+ * one kernel tick, called by the HPS timer 0 interrupt every g_rtx_qtm us.
+ * Releases the tasks that are due and returns TRUE if the running task has to make way
+ */
+BOOL k_tsk_tick(void)
+{
+	TCB *p_cur = gp_current_task;
+	if (p_cur -> prio != PRIO_RT && p_cur -> prio != PRIO_BG && p_cur -> prio != PRIO_NULL) {
+		g_ps_ran = TRUE;
+	}
+	if (g_sched == RM_PS && g_ps_ran && g_ps_budget != 0) {
+		// the tick that just ended went to tasks on the server budget, even if only part of it
+		g_ps_budget--;
+	}
+	g_ps_ran = FALSE;
+
+	g_rtx_ticks++;
+	while (gp_deadline_head != NULL && (S32) (gp_deadline_head -> rtDeadline - g_rtx_ticks) <= 0) {
+		// a job that has not called k_tsk_done_rt by its deadline
+		TCB *p_tcb = gp_deadline_head;
+		gp_deadline_head = p_tcb -> dlNext;
+		rtMiss(p_tcb);
+	}
+	while (gp_sleep_head != NULL && (S32) (gp_sleep_head -> wakeTick - g_rtx_ticks) <= 0) {
+		TCB *p_tcb = gp_sleep_head;
+		gp_sleep_head = p_tcb -> sleepNext;
+		p_tcb -> state = READY;
+		if (p_tcb -> sleepJob) {
+			rtJobRelease(p_tcb, p_tcb -> wakeTick);
+		} else {
+			insertNode(p_tcb);
+		}
+	}
+
+	if (g_sched == RM_PS) {
+		if ((S32) (g_ps_release + g_ps_period - g_rtx_ticks) <= 0) {
+			g_ps_release += g_ps_period;
+			g_ps_budget = g_ps_capacity;
+		}
+		if (serverRuns() && topPrioBelowRt() == PRIO_NULL) {
+			// the server polls and finds nothing to run, its budget is gone until the next period
+			g_ps_budget = 0;
+		}
+	}
+	return scheduler() != gp_current_task;
 }
 
+/* the polling server of RM_PS, its budget has to fit in its period */
+int k_tsk_server_init(POLLING_SERVER *server)
+{
+	g_ps_period = tv_to_ticks(&server -> p_n);
+	g_ps_capacity = tv_to_ticks(&server -> b_n);
+	if (g_ps_period == 0 || g_ps_capacity == 0 || g_ps_capacity > g_ps_period) {
+		return RTX_ERR;
+	}
+	g_ps_server = *server;
+	g_ps_budget = g_ps_capacity;
+	g_ps_release = g_rtx_ticks;
+
+	// to admission control the server is a periodic task that runs for its whole budget
+	g_ps_tcb.rtPeriod = g_ps_period;
+	g_ps_tcb.rtWcet = g_ps_capacity;
+	g_ps_tcb.rtResponse = g_ps_capacity;
+	rtSetLink(&g_ps_tcb);
+	return RTX_OK;
+}
+
+/* the caller sleeps for tv, rounded to ticks: it wakes up at the tick boundary tv after the last one */
 void k_tsk_suspend(TIMEVAL *tv)
 {
 #ifdef DEBUG_0
     printf("k_tsk_suspend: Entering\r\n");
 #endif /* DEBUG_0 */
-    return;
+	TCB *p_tcb = gp_current_task;
+	U32 ticks = tv_to_ticks(tv);
+	if (ticks == 0 || p_tcb -> prio == PRIO_NULL) {
+		return;
+	}
+
+	popMinNode();
+	p_tcb -> state = SUSPENDED;
+	p_tcb -> sleepJob = FALSE;
+	sleepInsert(p_tcb, g_rtx_ticks + ticks);
+	k_tsk_run_new();
+}
+
+/*
+ * what happens to the late jobs of real-time task task_id, see MISS_* in common_ext.h.
+ * Under MISS_NOTIFY every miss is sent to supervisor as an RT_MISS message. MISS_ABORT
+ * starts the task over in user mode, so it is only for unprivileged tasks
+ */
+int k_tsk_set_miss_policy(task_t task_id, U8 policy, task_t supervisor)
+{
+#ifdef DEBUG_0
+    printf("k_tsk_set_miss_policy: task_id = %d, policy = %d, supervisor = %d\r\n", task_id, policy, supervisor);
+#endif /* DEBUG_0 */
+	if (task_id >= MAX_TASKS || g_tcbs[task_id] -> state == DORMANT || g_tcbs[task_id] -> rtPeriod == 0) {
+		return RTX_ERR;
+	}
+	TCB *p_tcb = g_tcbs[task_id];
+	U8 action = policy & ~MISS_NOTIFY;
+	if (action > MISS_DEMOTE
+			|| (action == MISS_ABORT && p_tcb -> priv != 0)
+			|| ((policy & MISS_NOTIFY) && (supervisor >= MAX_TASKS || g_tcbs[supervisor] -> state == DORMANT))) {
+		return RTX_ERR;
+	}
+	p_tcb -> rtPolicy = policy;
+	p_tcb -> rtSupervisor = (policy & MISS_NOTIFY) ? supervisor : TID_NULL;
+	return RTX_OK;
+}
+
+int k_tsk_get_rt_stats(task_t task_id, RTX_RT_STATS *buffer)
+{
+	if (buffer == NULL || task_id >= MAX_TASKS || g_tcbs[task_id] -> state == DORMANT || g_tcbs[task_id] -> rtPeriod == 0) {
+		return RTX_ERR;
+	}
+	TCB *p_tcb = g_tcbs[task_id];
+	buffer -> jobs = p_tcb -> rtJobs;
+	buffer -> misses = p_tcb -> rtMisses;
+	ticks_to_tv(p_tcb -> rtWorst, &buffer -> worst_response);
+	buffer -> policy = p_tcb -> rtPolicy;
+	buffer -> supervisor = p_tcb -> rtSupervisor;
+	return RTX_OK;
 }
 
 /*
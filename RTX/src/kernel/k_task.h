@@ -46,6 +46,14 @@
 #include "k_HAL_CA.h"
 #include "../app/kcd_task.h"
 
+/*
+ *==========================================================================
+ *                            MACROS
+ *==========================================================================
+ */
+
+#define K_STACK_MIN         0x100   /* smallest kernel stack a task can ask for, see k_tsk_create_new */
+
 /*
  *==========================================================================
  *                            GLOBAL VARIABLES
@@ -70,6 +78,8 @@ int     k_tsk_init          (RTX_TASK_INFO *task_info, int num_tasks);
 int     k_tsk_create_new    (RTX_TASK_INFO *p_taskinfo, TCB *p_tcb, task_t tid);
                                  /* create a new task with initial context sitting on a dummy stack frame */
 TCB *   scheduler           (void);  /* return the TCB of the next ready to run task */
+TCB *   k_tsk_alloc_tcb     (task_t tid);   /* a new TCB for tid */
+void    k_tsk_free_tcb      (task_t tid);   /* give back the TCB of a task that never ran */
 void    k_tsk_switch        (TCB *); /* kernel thread context switch, two stacks */
 int     k_tsk_run_new       (void);  /* kernel runs a new thread  */
 int     k_tsk_yield         (void);  /* kernel tsk_yield function */
@@ -79,28 +89,25 @@ int     k_tsk_create        (task_t *task, void (*task_entry)(void), U8 prio, U1
 void    k_tsk_exit          (void);
 int     k_tsk_set_prio      (task_t task_id, U8 prio);
 int     k_tsk_get_info      (task_t task_id, RTX_TASK_INFO *buffer);
+int     k_tsk_get_stack_use (task_t task_id, U16 *k_used, U16 *u_used);
 task_t  k_tsk_get_tid       (void);
+int     k_tsk_ls            (task_t *buf, int count);
+int     k_tsk_ls_live       (task_t *buf, int count, BOOL mbx_only);   /* shared by k_tsk_ls and k_mbx_ls */
 int     k_tsk_create_rt     (task_t *tid, TASK_RT *task);
 void    k_tsk_done_rt       (void);
 void    k_tsk_suspend       (struct timeval_rt *tv);
+BOOL    k_tsk_tick          (void);  /* kernel tick, releases real-time jobs, TRUE if the running task is preempted */
+int     k_tsk_server_init   (POLLING_SERVER *server);  /* budget and period of the RM_PS polling server */
+int     k_tsk_set_miss_policy(task_t task_id, U8 policy, task_t supervisor);
+int     k_tsk_get_rt_stats  (task_t task_id, RTX_RT_STATS *buffer);
 
 // helper functions added by students
-int getParentIndex(int index);
-int getLeftChildIndex(int index);
-int getRightChildIndex(int index);
 int insertNode(TCB *node);
-int hasGreaterPrioity(TCB* nodeA, TCB* nodeB);
 int popMinNode(void);
-int heapify(int curIndex);
-task_t nextInsertionOrder(void);
-void updateMinInsertionOrder(task_t order);
-int isEarlier(task_t a, task_t b);
 int isQHigherPrioThanP(U8 Q, U8 P);
-int switchToTask(TCB* newTask);
-int replaceTopNode(TCB *node);
-void assignInsertionOrderToNode(TCB *node);
-int removeElement(int index);
-int getIndex(TCB* tcbPtr);
+int runsBefore(TCB *B, TCB *A);
+int insertNodePreempt(TCB *B);
+int removeElement(TCB *node);
 
 
 #endif // ! K_TASK_H_
@@ -57,6 +57,13 @@ void task_null (void)
             printf("==============Task NULL===============\r\n");
         }
 #endif
+#ifdef MEM_CHECK
+        // idle time goes to walking the heap, stop once it found something so the report stays readable
+        static BOOL heap_ok = TRUE;
+        if (heap_ok && k_mem_check() != RTX_OK) {
+            heap_ok = FALSE;
+        }
+#endif /* MEM_CHECK */
         k_tsk_yield();
     }
 }
@@ -80,7 +87,11 @@ int main()
     // start the RTX and built-in tasks
     if (mode == MODE_SVC) {
         gp_current_task = NULL;
-        k_rtx_init(task_info, BOOT_TASKS);
+        if (k_rtx_init_rt(&sys_info, task_info, BOOT_TASKS) != RTX_OK) {
+            // no task was set up, task_null() has nothing to run
+            printf("RTX INIT FAILED\r\n");
+            return RTX_ERR;
+        }
     }
 
     task_null();
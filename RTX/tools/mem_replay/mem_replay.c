@@ -0,0 +1,310 @@
+/**************************************************************************//**
+ * @file        mem_replay.c
+ * @brief       replay a k_mem allocation trace on a PC
+ *
+ * @details     Build the kernel with MEM_TRACE defined and call mem_trace_dump()
+ *              (or k_mem_trace_dump() from the kernel) to print the trace over UART.
+ *              Save the console output to a file and feed it to this tool, which
+ *              links the unmodified kernel/k_mem.c and replays every alloc and
+ *              dealloc against each heap algorithm, timing every call.
+ *
+ *              gcc -O2 -Istub -I../../src/kernel -I../../src/INC \
+ *                  -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast \
+ *                  ../../src/kernel/k_mem.c replay_glue.c mem_replay.c -o mem_replay
+ *
+ *              ./mem_replay [-a algo[,algo...]] [-s memory bytes] trace.log
+ *
+ *              algo is the number from common.h / common_ext.h (1 FIRST_FIT, 2 BEST_FIT, 4 TLSF, 5 SEG_FIT),
+ *              by default all of them but SEG_FIT, which is opt-in on the board as well,
+ *              the size defaults to the memory the trace was recorded with, heap and
+ *              stack region, so k_mem_init_algo() makes the same split.
+ *
+ * @note        k_mem.c keeps addresses in U32s, so on a 64 bit host the arena has
+ *              to sit below 4GB, which is what MAP_32BIT is for.
+ *****************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIME_UNIT "cycles"
+#else
+#define TIME_UNIT "ns"
+#endif
+
+/* kernel side, see replay_glue.c */
+extern void *k_mem_alloc(unsigned int size);
+extern int k_mem_dealloc(void *ptr);
+extern int k_mem_init_algo(int algo);
+extern int k_mem_count_extfrag(unsigned int size);
+extern void replay_init(void);
+extern void replay_set_tid(unsigned int tid);
+extern unsigned int *g_replay_arena;
+extern unsigned int g_replay_arena_size;
+
+#define RTX_OK          0
+#define HIST_BUCKETS    24
+#define MAX_ALGOS       8
+
+typedef struct {
+    char op;                // I, A or F
+    unsigned int tid;
+    unsigned int size;
+    unsigned int ptr;       // address on the board
+} Rec;
+
+typedef struct {
+    unsigned long count;
+    uint64_t total;
+    uint64_t max;
+    unsigned long hist[HIST_BUCKETS];   // bucket i: [2^(i-1), 2^i) time units
+} Timing;
+
+/* recorded pointer -> replayed pointer, open addressing */
+typedef struct {
+    unsigned int key;       // 0 empty, 1 deleted, anything else a recorded pointer
+    void *val;
+} Slot;
+
+static Slot *g_map;
+static size_t g_map_mask;
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+/* the A9 private timer counts down in us, only used by MEM_STATS / MEM_TRACE builds */
+unsigned int timer_get_current_val(int n)
+{
+    struct timespec ts;
+    (void) n;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 0xFFFFFFFFu - (unsigned int) (ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+static void timing_add(Timing *t, uint64_t dt)
+{
+    int bucket = 0;
+    while (bucket < HIST_BUCKETS - 1 && (dt >> bucket) != 0) {
+        bucket++;
+    }
+    t->count++;
+    t->total += dt;
+    if (dt > t->max) {
+        t->max = dt;
+    }
+    t->hist[bucket]++;
+}
+
+static size_t map_hash(unsigned int key)
+{
+    return (size_t) ((key >> 3) * 2654435761u) & g_map_mask;
+}
+
+static void map_clear(void)
+{
+    memset(g_map, 0, (g_map_mask + 1) * sizeof(Slot));
+}
+
+static void map_put(unsigned int key, void *val)
+{
+    size_t i = map_hash(key);
+    while (g_map[i].key > 1 && g_map[i].key != key) {
+        i = (i + 1) & g_map_mask;
+    }
+    g_map[i].key = key;
+    g_map[i].val = val;
+}
+
+/* removes key and returns its value, NULL if it is not there */
+static void *map_take(unsigned int key)
+{
+    size_t i = map_hash(key);
+    while (g_map[i].key != 0) {
+        if (g_map[i].key == key) {
+            g_map[i].key = 1;
+            return g_map[i].val;
+        }
+        i = (i + 1) & g_map_mask;
+    }
+    return NULL;
+}
+
+/* reads the first MEMTRACE block in f, returns the number of records */
+static size_t load_trace(FILE *f, Rec **recs, unsigned int *heap_bytes)
+{
+    char line[256];
+    size_t n = 0, cap = 1024;
+    unsigned int count, lost;
+    int in_trace = 0;
+
+    *recs = malloc(cap * sizeof(Rec));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (!in_trace) {
+            if (sscanf(line, "MEMTRACE BEGIN %u %u %u", heap_bytes, &count, &lost) == 3) {
+                in_trace = 1;
+                if (lost != 0) {
+                    fprintf(stderr, "note: %u records were lost to the ring wrapping, "
+                            "frees of older blocks will not match\n", lost);
+                }
+            }
+            continue;
+        }
+        if (strncmp(line, "MEMTRACE END", 12) == 0) {
+            break;
+        }
+
+        Rec r;
+        if (sscanf(line, " %c %u %u %x", &r.op, &r.tid, &r.size, &r.ptr) != 4
+                || (r.op != 'A' && r.op != 'F' && r.op != 'I')) {
+            continue;   // console noise in the middle of the dump
+        }
+        if (n == cap) {
+            cap *= 2;
+            *recs = realloc(*recs, cap * sizeof(Rec));
+        }
+        (*recs)[n++] = r;
+    }
+    return n;
+}
+
+static int replay(int algo, const Rec *recs, size_t n)
+{
+    Timing alloc_t = {0}, dealloc_t = {0};
+    unsigned long replay_fail = 0, record_fail = 0, unmatched = 0;
+
+    if (k_mem_init_algo(algo) != RTX_OK) {
+        printf("algo %d: k_mem_init_algo failed\n", algo);
+        return -1;
+    }
+    map_clear();
+
+    for (size_t i = 0; i < n; i++) {
+        const Rec *r = &recs[i];
+        replay_set_tid(r->tid);
+
+        if (r->op == 'I') {     // the board re-initialized its heap, we keep our algorithm
+            k_mem_init_algo(algo);
+            map_clear();
+        } else if (r->op == 'A') {
+            uint64_t start = now();
+            void *p = k_mem_alloc(r->size);
+            timing_add(&alloc_t, now() - start);
+
+            if (r->ptr == 0) {
+                record_fail++;
+                if (p != NULL) {    // the task never saw this block, do not keep it
+                    k_mem_dealloc(p);
+                }
+            } else if (p == NULL) {
+                replay_fail++;
+            } else {
+                map_put(r->ptr, p);
+            }
+        } else {
+            void *p = map_take(r->ptr);
+            if (p == NULL) {
+                unmatched++;
+                continue;
+            }
+            uint64_t start = now();
+            k_mem_dealloc(p);
+            timing_add(&dealloc_t, now() - start);
+        }
+    }
+
+    printf("algo %d\n", algo);
+    printf("  alloc   %9lu calls, avg %8.1f max %10llu %s\n", alloc_t.count,
+           alloc_t.count ? (double) alloc_t.total / alloc_t.count : 0.0,
+           (unsigned long long) alloc_t.max, TIME_UNIT);
+    printf("  dealloc %9lu calls, avg %8.1f max %10llu %s\n", dealloc_t.count,
+           dealloc_t.count ? (double) dealloc_t.total / dealloc_t.count : 0.0,
+           (unsigned long long) dealloc_t.max, TIME_UNIT);
+    printf("  failed on the board %lu, failed here but not on the board %lu, unmatched frees %lu\n",
+           record_fail, replay_fail, unmatched);
+    printf("  free blocks at the end %d\n", k_mem_count_extfrag(0x7FFFFFFF));
+    printf("  %-10s %12s %12s\n", TIME_UNIT " <", "alloc", "dealloc");
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (alloc_t.hist[b] || dealloc_t.hist[b]) {
+            printf("  %-10llu %12lu %12lu\n", 1ULL << b, alloc_t.hist[b], dealloc_t.hist[b]);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int algos[MAX_ALGOS] = {1, 2, 4};
+    int num_algos = 3;
+    unsigned int heap_bytes = 0, forced_heap = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            num_algos = 0;
+            for (char *tok = strtok(argv[++i], ","); tok && num_algos < MAX_ALGOS; tok = strtok(NULL, ",")) {
+                algos[num_algos++] = atoi(tok);
+            }
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            forced_heap = (unsigned int) strtoul(argv[++i], NULL, 0);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE *f = path ? fopen(path, "r") : stdin;
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    Rec *recs;
+    size_t n = load_trace(f, &recs, &heap_bytes);
+    if (n == 0) {
+        fprintf(stderr, "no MEMTRACE records found\n");
+        return 1;
+    }
+    if (forced_heap != 0) {
+        heap_bytes = forced_heap;
+    }
+
+    /* the heap has to be addressable through a U32, see the note at the top */
+    g_replay_arena_size = (heap_bytes + 4095) & ~4095u;
+#ifdef MAP_32BIT
+    void *arena = mmap(NULL, g_replay_arena_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    g_replay_arena = (arena == MAP_FAILED) ? NULL : arena;
+#else
+    g_replay_arena = (sizeof(void *) == 4) ? malloc(g_replay_arena_size) : NULL;
+#endif
+    if (g_replay_arena == NULL) {
+        fprintf(stderr, "could not get a %u byte arena below 4GB\n", g_replay_arena_size);
+        return 1;
+    }
+
+    size_t map_size = 1024;
+    while (map_size < 2 * n) {
+        map_size <<= 1;
+    }
+    g_map = malloc(map_size * sizeof(Slot));
+    g_map_mask = map_size - 1;
+
+    replay_init();
+    printf("%zu records, %u byte heap\n", n, g_replay_arena_size);
+    for (int i = 0; i < num_algos; i++) {
+        replay(algos[i], recs, n);
+    }
+    return 0;
+}
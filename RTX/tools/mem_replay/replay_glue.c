@@ -0,0 +1,31 @@
+/**************************************************************************//**
+ * @file        replay_glue.c
+ * @brief       kernel globals k_mem.c expects, for the host replay build
+ *
+ * @note        built against the kernel headers, so it must not pull in the C
+ *              library (common.h has its own size_t). mem_replay.c does the rest.
+ *****************************************************************************/
+
+#include "k_inc.h"
+
+unsigned int *g_replay_arena = NULL;    // heap start, see stub/device_a9.h
+unsigned int g_replay_arena_size = 0;   // heap size in bytes
+
+TCB *g_tcbs[MAX_TASKS];                // k_mem_reclaim and k_mem_dump_task look owners up here
+TCB g_tcb_dormant;
+TCB g_replay_tcb;                       // the "current task", only its tid matters to k_mem.c
+TCB *gp_current_task = &g_replay_tcb;
+
+static TCB g_replay_tcbs[MAX_TASKS];    // every tid in a trace gets its own TCB, so its blocks get their own owner list
+
+void replay_init(void)
+{
+    for (int i = 0; i < MAX_TASKS; i++) {
+        g_tcbs[i] = &g_replay_tcbs[i];
+    }
+}
+
+void replay_set_tid(unsigned int tid)
+{
+    g_replay_tcb.tid = (task_t) tid;
+}
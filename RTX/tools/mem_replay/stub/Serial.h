@@ -0,0 +1,8 @@
+/**************************************************************************//**
+ * @file        Serial.h
+ * @brief       host stand-in for the UART driver, k_mem.c only needs printf
+ *****************************************************************************/
+
+#ifndef SERIAL_H_
+#define SERIAL_H_
+#endif // ! SERIAL_H_
@@ -0,0 +1,23 @@
+/**************************************************************************//**
+ * @file        device_a9.h
+ * @brief       host stand-in for the board header, only what k_mem.c needs
+ *
+ * @note        the heap lives in an arena mem_replay gets from the host, see replay_glue.c
+ *****************************************************************************/
+
+#ifndef DEVICE_A9_H_
+#define DEVICE_A9_H_
+
+extern unsigned int *g_replay_arena;
+extern unsigned int g_replay_arena_size;
+
+// k_inc.h declares the linker symbol, this turns &Image$$ZI_DATA$$ZI$$Limit into the arena start
+#define Image$$ZI_DATA$$ZI$$Limit (*g_replay_arena)
+
+#define RAM_START ((unsigned int)(unsigned long)g_replay_arena)
+#define RAM_END   (RAM_START + g_replay_arena_size - 1)
+
+// armcc intrinsic, ARM returns 32 for 0
+#define __clz(x) ((x) ? __builtin_clz(x) : 32)
+
+#endif // ! DEVICE_A9_H_
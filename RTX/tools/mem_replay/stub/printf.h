@@ -0,0 +1,11 @@
+/**************************************************************************//**
+ * @file        printf.h
+ * @brief       host stand-in, the C library printf instead of tfp_printf
+ *****************************************************************************/
+
+#ifndef __TFP_PRINTF__
+#define __TFP_PRINTF__
+
+int printf(const char *fmt, ...);
+
+#endif // ! __TFP_PRINTF__
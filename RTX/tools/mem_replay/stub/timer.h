@@ -0,0 +1,11 @@
+/**************************************************************************//**
+ * @file        timer.h
+ * @brief       host stand-in for the timer driver, see replay_glue.c
+ *****************************************************************************/
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+unsigned int timer_get_current_val(int n);
+
+#endif // ! TIMER_H_